@@ -1,5 +1,6 @@
 #include "BuildWatch/BuildWatchTask.hpp"
 #include "BuildWatch/ConfigReader.hpp"
+#include "BuildWatch/Regenerate.hpp"
 #include "spdlog/async.h"
 
 #include <CLI/CLI.hpp>
@@ -93,6 +94,20 @@ int main(int argc, char** argv)
     bool dryRun{false};
     app.add_flag("--dry-run", dryRun, "Write generated files to stdout, not to disk");
 
+    bool once{false};
+    auto* onceOption = app.add_flag(
+        "--once",
+        once,
+        "Regenerate everything and exit: 0 if it was all up to date, 1 if anything changed, 2 on errors");
+
+    bool check{false};
+    app.add_flag(
+           "--check",
+           check,
+           "Check the generated files are up to date, printing a diff of any that aren't, and exit without writing "
+           "anything: 0 if they're all up to date, 1 if not, 2 on errors")
+        ->excludes(onceOption);
+
     bool generateConfig{false};
     app.add_flag("-g,--generateConfig", generateConfig, "generate a simple config");
 
@@ -112,6 +127,38 @@ int main(int argc, char** argv)
     const btl::ConfigReader configReader{path, btl::to_string(btl::Config::defaultConfiguration())};
     const auto& config = configReader.get();
 
+    if (once) {
+        const auto report = btl::regenerateAll(path, config, dryRun);
+        for (const auto& changed : report.changed) {
+            std::cout << changed.string() << '\n';
+        }
+        spdlog::info(
+            "{} templates, {} out of date, {} failed", report.templates, report.changed.size(), report.failed.size());
+        if (!report.failed.empty()) {
+            return 2;
+        }
+        return report.changed.empty() ? 0 : 1;
+    }
+
+    if (check) {
+        const auto report = btl::checkAll(path, config);
+        for (const auto& mismatch : report.mismatches) {
+            std::cout << mismatch.diff;
+        }
+        for (const auto& mismatch : report.mismatches) {
+            std::cout << fmt::format("Out of date: {} (+{} -{})\n", mismatch.dest, mismatch.added, mismatch.removed);
+        }
+        spdlog::info(
+            "{} templates, {} out of date, {} failed",
+            report.templates,
+            report.mismatches.size(),
+            report.failed.size());
+        if (!report.failed.empty()) {
+            return 2;
+        }
+        return report.mismatches.empty() ? 0 : 1;
+    }
+
     std::signal(SIGINT, signalHandler);
 
     btl::BuildWatchTask task;
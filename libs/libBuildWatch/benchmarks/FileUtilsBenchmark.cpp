@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "FileIndex.hpp"
+#include "FileUtils.hpp"
+#include "SourceTree.hpp"
+#include <benchmark/benchmark.h>
+#include <spdlog/spdlog.h>
+
+namespace {
+
+void BM_getAllFiles(benchmark::State& state)
+{
+    spdlog::set_level(spdlog::level::warn);
+    const auto& tree = btl::bench::SourceTree::get(state.range(0));
+    const auto extensions = btl::TemplateFile::defaultConfiguration().extensions;
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(btl::getAllFiles(tree.templatePath(), extensions));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_getAllFiles)->Arg(1'000)->Arg(10'000)->Arg(100'000)->Unit(benchmark::kMillisecond);
+
+void BM_FileIndexFiles(benchmark::State& state)
+{
+    spdlog::set_level(spdlog::level::warn);
+    const auto& tree = btl::bench::SourceTree::get(state.range(0));
+    const auto templateFile = btl::TemplateFile::defaultConfiguration();
+
+    btl::FileIndex index({templateFile});
+    for (const auto& file : btl::findAll(tree.root(), {".cpp", ".hpp", ".mustache"})) {
+        index.add(file);
+    }
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(index.files(templateFile, tree.templatePath()));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_FileIndexFiles)->Arg(1'000)->Arg(10'000)->Arg(100'000)->Unit(benchmark::kMillisecond);
+
+void BM_findUp(benchmark::State& state)
+{
+    spdlog::set_level(spdlog::level::warn);
+    const btl::TempDirectory root;
+    auto deepest = root.path();
+    for (int depth = 0; depth < 12; ++depth) {
+        deepest /= fmt::format("level{}", depth);
+    }
+    std::filesystem::create_directories(deepest);
+    std::ofstream(root.path() / "CMakeLists.txt.mustache") << "";
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(btl::findUp(deepest, "CMakeLists.txt.mustache", root.path().parent_path()));
+    }
+}
+BENCHMARK(BM_findUp);
+
+void BM_FileIndexFindTemplate(benchmark::State& state)
+{
+    const btl::TempDirectory root;
+    auto deepest = root.path();
+    for (int depth = 0; depth < 12; ++depth) {
+        deepest /= fmt::format("level{}", depth);
+    }
+
+    btl::FileIndex index({btl::TemplateFile::defaultConfiguration()}, root.path().parent_path());
+    index.add(root.path() / "CMakeLists.txt.mustache");
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(index.findTemplate(deepest, "CMakeLists.txt.mustache"));
+    }
+}
+BENCHMARK(BM_FileIndexFindTemplate);
+
+} // namespace
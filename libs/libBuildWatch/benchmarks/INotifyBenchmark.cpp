@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "INotify.hpp"
+#include <TestHelpers/TempDirectory.hpp>
+#include <benchmark/benchmark.h>
+#include <fstream>
+#include <malloc.h>
+#include <spdlog/spdlog.h>
+
+namespace {
+
+/// Time to dispatch a burst of events, e.g. from unpacking an archive.  The reader thread does the draining.
+void BM_INotifyDispatch(benchmark::State& state)
+{
+    namespace fs = std::filesystem;
+    spdlog::set_level(spdlog::level::warn);
+
+    const btl::TempDirectory root;
+    btl::INotify inotify;
+
+    std::size_t events{};
+    inotify.onEvent([&events](const btl::INotifyRecord&, const btl::INotifyWatch&) { ++events; });
+    inotify.addWatch(root.path());
+
+    const auto waitFor = [&inotify, &events](const std::size_t expected) {
+        for (int i = 0; i < 100 && events < expected; ++i) {
+            inotify.watchOnce(std::chrono::milliseconds(100));
+        }
+    };
+
+    // Plenty of other watches, so the lookup isn't trivially cheap
+    constexpr std::size_t directoryCount = 1'000;
+    for (std::size_t i = 0; i < directoryCount; ++i) {
+        const auto directory = root.path() / fmt::format("dir{}", i);
+        fs::create_directory(directory);
+        inotify.addWatch(directory);
+    }
+    waitFor(directoryCount);
+
+    const auto fileCount = static_cast<std::size_t>(state.range(0));
+    for (auto _ : state) {
+        state.PauseTiming();
+        for (std::size_t i = 0; i < fileCount; ++i) {
+            std::ofstream(root.path() / fmt::format("file{}.cpp", i));
+        }
+        state.ResumeTiming();
+
+        waitFor(events + fileCount);
+
+        state.PauseTiming();
+        for (std::size_t i = 0; i < fileCount; ++i) {
+            fs::remove(root.path() / fmt::format("file{}.cpp", i));
+        }
+        waitFor(events + fileCount);
+        state.ResumeTiming();
+    }
+    state.counters["events"] = benchmark::Counter(static_cast<double>(events), benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_INotifyDispatch)->Arg(1'000)->Iterations(20)->Unit(benchmark::kMillisecond);
+
+/// Time to remove a small subtree from amongst many watches, e.g. `rm -rf` of one directory in a big tree
+void BM_INotifyRemoveSubtree(benchmark::State& state)
+{
+    namespace fs = std::filesystem;
+    spdlog::set_level(spdlog::level::warn);
+
+    const btl::TempDirectory root;
+    btl::INotify inotify;
+    inotify.addWatch(root.path());
+    for (std::int64_t i = 0; i < state.range(0); ++i) {
+        const auto directory = root.path() / fmt::format("dir{}", i);
+        fs::create_directory(directory);
+        inotify.addWatch(directory);
+    }
+
+    const auto subtree = root.path() / "subtree";
+    std::vector<fs::path> directories{subtree};
+    for (int i = 0; i < 10; ++i) {
+        directories.push_back(subtree / fmt::format("dir{}", i));
+    }
+    for (const auto& directory : directories) {
+        fs::create_directory(directory);
+    }
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        for (const auto& directory : directories) {
+            inotify.addWatch(directory);
+        }
+        state.ResumeTiming();
+
+        inotify.remove(subtree);
+    }
+}
+BENCHMARK(BM_INotifyRemoveSubtree)->Arg(10'000)->Iterations(2'000)->Unit(benchmark::kMicrosecond);
+
+/// Heap used per watch, i.e. what we keep for each directory in a big tree (the kernel's memory isn't counted)
+void BM_INotifyMemoryPerWatch(benchmark::State& state)
+{
+    namespace fs = std::filesystem;
+    spdlog::set_level(spdlog::level::warn);
+
+    const btl::TempDirectory root;
+    std::vector<fs::path> directories;
+    for (std::int64_t i = 0; i < state.range(0); ++i) {
+        // Typical source directory names, short enough not to allocate
+        directories.push_back(root.path() / fmt::format("module{}", i));
+        fs::create_directory(directories.back());
+    }
+
+    double bytesPerWatch{};
+    for (auto _ : state) {
+        btl::INotify inotify;
+        inotify.addWatch(root.path());
+
+        const auto before = mallinfo2().uordblks;
+        inotify.addWatches(directories);
+        const auto after = mallinfo2().uordblks;
+        bytesPerWatch = static_cast<double>(after - before) / static_cast<double>(directories.size());
+    }
+    state.counters["bytesPerWatch"] = bytesPerWatch;
+}
+BENCHMARK(BM_INotifyMemoryPerWatch)->Arg(10'000)->Iterations(3)->Unit(benchmark::kMillisecond);
+
+} // namespace
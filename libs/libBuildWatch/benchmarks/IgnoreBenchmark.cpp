@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "Ignore.hpp"
+#include <benchmark/benchmark.h>
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+
+namespace {
+
+/// Something like a big monorepo's .gitignore
+std::vector<std::string> gitignore()
+{
+    std::vector<std::string> lines = {
+        "build/", "/out/", "cmake-build-*/", "node_modules/", ".idea/", ".vscode/", "**/__pycache__/",
+        "/third-party/*/build/", "docs/_build/", "*.o", "*.so", "*.a", "*.pyc", "!/third-party/keep/",
+        ".cache/", "bazel-*/", "/dist/", "coverage/", "**/target/", "tmp?/",
+    };
+    // Pad it out with lots of anchored directories, as generated ignore files tend to have.
+    for (int i = 0; i < 280; ++i) {
+        lines.push_back(fmt::format("/generated/component{}/output/", i));
+    }
+    return lines;
+}
+
+/// Directories relative to the root, a mix of ignored and not
+std::vector<std::filesystem::path> directories(const std::filesystem::path& root)
+{
+    std::vector<std::filesystem::path> result;
+    for (int i = 0; i < 1'000; ++i) {
+        result.push_back(root / fmt::format("libs/lib{}/src/module{}", i % 50, i));
+        result.push_back(root / fmt::format("libs/lib{}/build/CMakeFiles/obj{}", i % 50, i));
+    }
+    return result;
+}
+
+void BM_IgnoreConstruction(benchmark::State& state)
+{
+    const auto lines = gitignore();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(btl::Ignore("/repo", lines));
+    }
+}
+BENCHMARK(BM_IgnoreConstruction);
+
+void BM_IgnoreIgnore(benchmark::State& state)
+{
+    spdlog::set_level(spdlog::level::warn);
+    const std::filesystem::path root = "/repo";
+    const btl::Ignore ignore(root, gitignore());
+    const auto paths = directories(root);
+
+    for (auto _ : state) {
+        for (const auto& path : paths) {
+            benchmark::DoNotOptimize(ignore.ignore(path));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(paths.size()));
+}
+BENCHMARK(BM_IgnoreIgnore)->Unit(benchmark::kMillisecond);
+
+} // namespace
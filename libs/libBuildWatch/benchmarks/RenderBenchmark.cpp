@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "Template.hpp"
+#include <benchmark/benchmark.h>
+#include <fmt/format.h>
+
+namespace {
+
+void BM_render(benchmark::State& state)
+{
+    const std::string cmake = "add_library(lib\n{{#files}}\n    {{relpath}}\n{{/files}}\n)\n";
+    std::vector<std::filesystem::path> files;
+    for (std::int64_t i = 0; i < state.range(0); ++i) {
+        files.emplace_back(fmt::format("module{}/part{}/file{}.cpp", i / 1000, (i / 100) % 10, i % 100));
+    }
+
+    btl::Template tmpl(cmake);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(tmpl.render(files));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_render)->Arg(100)->Arg(1'000)->Arg(20'000)->Unit(benchmark::kMicrosecond);
+
+void BM_parse(benchmark::State& state)
+{
+    const std::string cmake = "add_library(lib\n{{#files}}\n    {{relpath}}\n{{/files}}\n)\n\n"
+                              "target_include_directories(lib PUBLIC ${CMAKE_CURRENT_SOURCE_DIR}/include)\n";
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(btl::Template(cmake));
+    }
+}
+BENCHMARK(BM_parse);
+
+} // namespace
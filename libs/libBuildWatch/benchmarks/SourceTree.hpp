@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+#include <TestHelpers/TempDirectory.hpp>
+#include <filesystem>
+#include <fmt/format.h>
+#include <fstream>
+#include <map>
+#include <memory>
+
+namespace btl::bench {
+
+/// A synthetic source tree: a `CMakeLists.txt.mustache` at the top of `lib/`, then directories of 100 files each, two
+/// levels deep, with a header for every source file.
+class SourceTree
+{
+public:
+    explicit SourceTree(const std::size_t fileCount)
+    {
+        std::ofstream(library() / "CMakeLists.txt.mustache") << "add_library(lib\n{{#files}}\n    {{relpath}}\n{{/files}}\n)\n";
+        constexpr std::size_t filesPerDirectory = 100;
+        for (std::size_t i = 0; i < fileCount; ++i) {
+            const auto directory = library() / fmt::format("module{:03}", i / (filesPerDirectory * 10))
+                / fmt::format("part{:02}", (i / filesPerDirectory) % 10);
+            if (i % filesPerDirectory == 0) {
+                std::filesystem::create_directories(directory);
+            }
+            std::ofstream(directory / fmt::format("file{:03}{}", i % filesPerDirectory, i % 2 ? ".hpp" : ".cpp"));
+        }
+    }
+
+    /// Shared between benchmarks, as building the big ones is slow.
+    static const SourceTree& get(const std::size_t fileCount)
+    {
+        static std::map<std::size_t, std::unique_ptr<SourceTree>> trees;
+        auto& tree = trees[fileCount];
+        if (!tree) {
+            tree = std::make_unique<SourceTree>(fileCount);
+        }
+        return *tree;
+    }
+
+    [[nodiscard]] std::filesystem::path root() const { return directory.path(); }
+
+    [[nodiscard]] std::filesystem::path library() const
+    {
+        const auto path = directory.path() / "lib";
+        std::filesystem::create_directories(path);
+        return path;
+    }
+
+    [[nodiscard]] std::filesystem::path templatePath() const { return library() / "CMakeLists.txt.mustache"; }
+
+private:
+    TempDirectory directory{};
+};
+
+} // namespace btl::bench
@@ -21,6 +21,7 @@
  */
 
 #pragma once
+#include <chrono>
 #include <nlohmann/json.hpp>
 #include <string>
 
@@ -51,6 +52,33 @@ struct Config
     std::vector<TemplateFile> files;
     std::vector<std::string> ignoreFiles;
 
+    /// Size (bytes) of the buffer used to drain inotify events.  Bigger means fewer `read` calls during event storms.
+    std::size_t readBufferSize{64 * 1024};
+
+    /// Wait for this long without any events before regenerating, so a burst of changes only regenerates once.
+    std::chrono::milliseconds debounce{50};
+
+    /// But never delay regenerating by more than this, even if the events keep coming.
+    std::chrono::milliseconds maxLatency{500};
+
+    /// Most inotify watches to use, zero for as many as `fs.inotify.max_user_watches` allows.  Directories we can't
+    /// watch are polled instead.
+    std::size_t maxWatches{};
+
+    /// How often to poll the directories we couldn't watch.
+    std::chrono::milliseconds pollInterval{2000};
+
+    /// Where events come from, `inotify`, or `fanotify` (which falls back to inotify if we lack the privileges).
+    std::string eventSource{"inotify"};
+
+    /// Where to save what we know about the tree between runs, relative to the root, so starting again only rescans
+    /// what changed.  Empty to scan everything on every start.
+    std::string stateFile{};
+
+    /// Most templates to render (and write) at once, zero for one per core.  Each generated file is only ever written
+    /// by one of them at a time.
+    std::size_t renderThreads{};
+
     /// Find a file name in the list of files
     [[nodiscard]] std::optional<TemplateFile> findFilename(const std::string& src) const;
 
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+#include <BuildWatch/Config.hpp>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace btl {
+
+/// What `regenerateAll` did
+struct RegenerateReport
+{
+    /// Templates found
+    std::size_t templates{};
+
+    /// Generated files that were out of date, and rewritten (unless it was a dry run).  Sorted.
+    std::vector<std::filesystem::path> changed{};
+
+    /// Templates that couldn't be rendered or written.  Sorted.
+    std::vector<std::filesystem::path> failed{};
+};
+
+/// What `checkAll` found
+struct CheckReport
+{
+    /// A generated file that doesn't match its template
+    struct Mismatch
+    {
+        std::filesystem::path dest{};
+
+        /// From what's on disk to what it should be, unified format, truncated to `maxDiffLines`
+        std::string diff{};
+
+        std::size_t added{};
+        std::size_t removed{};
+    };
+
+    /// Templates found
+    std::size_t templates{};
+
+    /// Sorted on `dest`
+    std::vector<Mismatch> mismatches{};
+
+    /// Templates that couldn't be rendered.  Sorted.
+    std::vector<std::filesystem::path> failed{};
+};
+
+/// Regenerate every template beneath `root` once, and return, e.g. for CI rather than watching.  The tree is scanned
+/// once, then templates are rendered on a pool of threads, as each only depends on its own directory.
+/// @param root directory to search for templates
+/// @param config the templates to look for, and ignore files
+/// @param dryRun report what's out of date, but don't write anything
+/// @param threadCount how many threads to use, zero for one per core
+/// @return what changed
+[[nodiscard]] RegenerateReport regenerateAll(
+    const std::filesystem::path& root, const Config& config, bool dryRun, std::size_t threadCount = 0);
+
+/// Render every template beneath `root` in memory and compare with what's on disk, never writing anything, e.g. as a CI
+/// gate.
+/// @param root directory to search for templates
+/// @param config the templates to look for, and ignore files
+/// @param maxDiffLines most lines of diff to keep for each mismatch
+/// @param threadCount how many threads to use, zero for one per core
+/// @return the generated files that are out of date, and how
+[[nodiscard]] CheckReport checkAll(
+    const std::filesystem::path& root,
+    const Config& config,
+    std::size_t maxDiffLines = 50,
+    std::size_t threadCount = 0);
+
+} // namespace btl
@@ -23,40 +23,47 @@
 #include "BuildWatch.hpp"
 #include "BuildWatch/Config.hpp"
 #include "FileUtils.hpp"
-#include "INotifyEvent.hpp"
+#include "Scanner.hpp"
 #include <algorithm>
 #include <fmt/std.h>
-#include <fstream>
-#include <mustache.hpp>
+#include <iostream>
 #include <nlohmann/json.hpp>
+#include <set>
 #include <spdlog/spdlog.h>
-#include <sys/inotify.h>
 
 namespace fs = std::filesystem;
 namespace rg = std::ranges;
 
-namespace btl {
+namespace {
 
-void BuildWatch::useIgnoreFile(const Config& config)
+/// Is `path` one of `directories`, or beneath one of them?
+bool isBeneath(fs::path path, const std::set<fs::path>& directories)
 {
-    bool foundIgnore = false;
-    for (const auto& ignoreFile : config.ignoreFiles) {
-        if (const auto path = btl::findUp(fs::current_path(), fs::path(ignoreFile))) {
-            ignore = Ignore(path->parent_path(), *path);
-            spdlog::info("Using .*ignore file: {}", *path);
-            foundIgnore = true;
-            break;
+    for (; path != path.parent_path(); path = path.parent_path()) {
+        if (directories.contains(path)) {
+            return true;
         }
     }
-    if (!foundIgnore) {
-        spdlog::warn("No .*ignore file found, we're watching all directories");
-    }
+    return false;
+}
+
+} // namespace
+
+namespace btl {
+
+void BuildWatch::useIgnoreFile(const Config& config)
+{
+    auto rules = loadIgnoreRules(rootPath, config.ignoreFiles);
+    ignore = std::move(rules.ignore);
+    ignorePath = std::move(rules.path);
 }
 
 BuildWatch::BuildWatch(const std::filesystem::path& rootDirectory, const Config& config, bool dryRun)
     : rootPath(rootDirectory)
     , config(config)
     , dryRun(dryRun)
+    , dirtyTemplates(config.debounce, config.maxLatency)
+    , renderPool(config.renderThreads)
 {
     spdlog::debug(fmt::format("Watching root directory: {}", rootDirectory.string()));
     nlohmann::json json;
@@ -72,13 +79,41 @@ BuildWatch::BuildWatch(const std::filesystem::path& rootDirectory, const Config&
     if (!fs::exists(rootPath)) {
         throw std::runtime_error(fmt::format("Supplied root-directory does not exist: {}", rootPath));
     }
+    // Absolute and without symlinks, like the paths fanotify gives us, so we can tell what's beneath it
+    rootPath = fs::weakly_canonical(rootPath);
+
+    index = FileIndex(config.files, rootPath);
 
     useIgnoreFile(config);
 
-    watchDirectory(rootDirectory);
+    eventSource = makeEventSource(
+        config,
+        rootPath,
+        [this](const fs::path& directory) { return isIgnored(directory); },
+        [this](const FileEvent& event) { onEvent(event); });
+
+    if (config.stateFile.empty() || !restore()) {
+        scanDirectory(rootPath, true, defaultThreadCount());
+    }
     spdlog::info("Watching...");
 }
 
+BuildWatch::~BuildWatch()
+{
+    // Don't lose edits made inside the debounce
+    flush();
+    renderPool.wait();
+    if (config.stateFile.empty() || !eventSource) {
+        return;
+    }
+
+    try {
+        save();
+    } catch (const std::exception& ex) {
+        spdlog::warn("Could not save state to {}: {}", rootPath / config.stateFile, ex.what());
+    }
+}
+
 // ReSharper disable once CppDFAConstantFunctionResult
 std::string BuildWatch::defaultConfig()
 {
@@ -90,50 +125,387 @@ std::string BuildWatch::defaultConfig()
 
 void BuildWatch::watchDirectory(const std::filesystem::path& directory)
 {
-    using namespace std::literals;
+    scanDirectory(directory, true);
+}
 
-    constexpr std::array ignores = { ".git"sv, ".hg"sv};
+bool BuildWatch::isIgnored(const std::filesystem::path& directory) const
+{
+    return isIgnoredDirectory(ignore, rootPath, directory);
+}
 
-    if (!fs::is_directory(directory)) {
-        spdlog::warn(fmt::format("Cannot watch, is not a directory: {}", directory.string()));
-        return;
+void BuildWatch::scanDirectory(
+    const std::filesystem::path& directory, const bool addWatches, const std::size_t threadCount)
+{
+    scanDirectories({directory}, addWatches, threadCount);
+}
+
+std::vector<std::filesystem::path> BuildWatch::scanDirectories(
+    const std::vector<std::filesystem::path>& directories,
+    const bool addWatches,
+    const std::size_t threadCount,
+    const SkipDirectory& alsoSkip)
+{
+    std::vector<fs::path> roots;
+    for (const auto& directory : directories) {
+        if (fs::is_directory(directory)) {
+            roots.push_back(directory);
+        } else {
+            spdlog::warn(fmt::format("Cannot watch, is not a directory: {}", directory.string()));
+        }
     }
 
-    inotify.addWatch(directory, [this](const inotify_event& event, const INotifyWatch& watch) {
-        this->onEvent(event, watch);
-    });
+    // Called from the scanner threads, only touches const state.
+    const auto skip = [this, &alsoSkip](const fs::path& subdirectory) {
+        return isIgnored(subdirectory) || (alsoSkip && alsoSkip(subdirectory));
+    };
 
-    for (const auto& subdirectory : fs::recursive_directory_iterator(directory)) {
-        if (!subdirectory.is_directory()) {
-            continue;
+    auto [scanned, files, modified] = scanTree(roots, skip, threadCount);
+
+    if (addWatches) {
+        watch(scanned);
+    }
+
+    for (const auto& file : files) {
+        index.add(file);
+    }
+
+    if (!config.stateFile.empty()) {
+        for (std::size_t i = 0; i < scanned.size(); ++i) {
+            directoryTimes.insert_or_assign(scanned[i].string(), modified[i]);
         }
+    }
+    return std::move(scanned);
+}
+
+void BuildWatch::watch(const std::vector<std::filesystem::path>& directories)
+{
+    const auto report = eventSource->addDirectories(directories);
+
+    // Better to carry on, and poll what we can't watch, than give up
+    if (!report.failed.empty()) {
+        spdlog::warn("Polling {} directories every {}ms", report.failed.size(), config.pollInterval.count());
+        startPolling(report.failed);
+    }
+}
+
+std::string BuildWatch::fingerprint() const
+{
+    nlohmann::json json;
+    to_json(json, config);
+    auto content = fmt::format("{}\n{}\n", rootPath.string(), json.dump());
+    if (!ignorePath.empty()) {
+        content += readFile(ignorePath);
+    }
+    return digest(content);
+}
 
-        const auto relpath = fs::relative(subdirectory, rootPath);
-        if (relpath.begin() != relpath.end() && rg::contains(ignores,  relpath.begin()->string()))
-        {
+State::Output BuildWatch::outputState(
+    const std::filesystem::path& templatePath,
+    const std::filesystem::path& destPath,
+    const std::vector<std::filesystem::path>& files) const
+{
+    // Errors give file_time_type::min(), so a missing file never matches what we saved
+    std::error_code ec;
+    return {
+        .sources = digest(files),
+        .templateModified = fs::last_write_time(templatePath, ec),
+        .destModified = fs::last_write_time(destPath, ec),
+    };
+}
+
+bool BuildWatch::restore()
+{
+    auto state = readState(rootPath / config.stateFile, fingerprint());
+    if (!state) {
+        return false;
+    }
+
+    // Directories whose modification time hasn't moved still hold the same entries, so we can take their files from
+    // the state.  Anything else gets rescanned, but only down to the sub-directories we know about, as they're checked
+    // in their own right.  So regenerating a template at the root doesn't mean rescanning the world.
+    const auto known = [&state](const fs::path& subdirectory) {
+        return state->directories.contains(subdirectory.string());
+    };
+
+    std::vector<fs::path> unchanged;
+    std::vector<fs::path> changed;
+    for (const auto& [directory, saved] : state->directories) {
+        const fs::path path(directory);
+
+        std::error_code ec;
+        const auto modified = fs::last_write_time(path, ec);
+        if (ec) {
+            // Gone, its parent has changed too, so is rescanned
             continue;
         }
 
-        if (ignore.ignore(subdirectory)) {
-            spdlog::trace("Ignoring directory due to .*ignore file: {}", subdirectory.path());
+        if (modified != saved.modified || modified == fs::file_time_type::min()) {
+            spdlog::debug("Changed since we last ran, rescanning: {}", path);
+            changed.push_back(path);
             continue;
         }
 
-        spdlog::debug("Watching subdir: {}", subdirectory.path());
-        inotify.addWatch(subdirectory, [this](const inotify_event& event, const INotifyWatch& watch) {
-            this->onEvent(event, watch);
-        });
+        unchanged.push_back(path);
+        directoryTimes.insert_or_assign(directory, modified);
+        for (const auto& name : saved.files) {
+            index.add(path / name);
+        }
+    }
+
+    // All at once, so a branch switch that touched hundreds of directories is one parallel walk, and one batch of
+    // watches
+    auto directories = scanDirectories(changed, false, defaultThreadCount(), known);
+    std::ranges::move(unchanged, std::back_inserter(directories));
+    watch(directories);
+
+    // Regenerate whatever changed while we weren't watching: the files, the template, or the generated file
+    std::size_t stale = 0;
+    for (const auto& templateFile : config.files) {
+        for (const auto& templatePath : index.templatePaths(templateFile)) {
+            const auto destPath = templatePath.parent_path() / templateFile.dest;
+            auto current = outputState(templatePath, destPath, index.files(templateFile, templatePath));
+
+            if (const auto iter = state->outputs.find(templatePath.string());
+                iter != state->outputs.end() && iter->second == current) {
+                std::scoped_lock lock(outputsMutex);
+                outputs.insert_or_assign(templatePath.string(), std::move(current));
+            } else {
+                spdlog::debug("Changed since we last ran: {}", templatePath);
+                regenerate(templateFile, templatePath);
+                ++stale;
+            }
+        }
+    }
+
+    spdlog::info(
+        "Restored state: {} directories unchanged, {} rescanned, {} templates to regenerate",
+        unchanged.size(),
+        changed.size(),
+        stale);
+    return true;
+}
+
+void BuildWatch::save() const
+{
+    State state{.fingerprint = fingerprint()};
+
+    for (const auto& [directory, modified] : directoryTimes) {
+        state.directories.emplace(directory, State::Directory{.modified = modified});
+    }
+    for (const auto& path : index.paths()) {
+        if (const auto iter = state.directories.find(path.parent_path().string()); iter != state.directories.end()) {
+            iter->second.files.push_back(path.filename().string());
+        }
+    }
+
+    {
+        std::scoped_lock lock(outputsMutex);
+        for (const auto& [templatePath, output] : outputs) {
+            if (index.hasTemplate(templatePath)) {
+                state.outputs.emplace(templatePath, output);
+            }
+        }
+    }
+
+    const auto path = rootPath / config.stateFile;
+    writeState(path, state);
+    spdlog::info("Saved state of {} directories to {}", state.directories.size(), path);
+}
+
+void BuildWatch::untrust(const std::filesystem::path& directory)
+{
+    if (const auto iter = directoryTimes.find(directory.string()); iter != directoryTimes.end()) {
+        iter->second = fs::file_time_type::min();
+    }
+}
+
+void BuildWatch::forgetDirectory(const std::filesystem::path& directory)
+{
+    auto prefix = directory.string();
+    if (!prefix.ends_with('/')) {
+        prefix.push_back('/');
+    }
+    auto end = prefix;
+    end.back() = '/' + 1;
+
+    directoryTimes.erase(directoryTimes.lower_bound(prefix), directoryTimes.lower_bound(end));
+    directoryTimes.erase(directory.string());
+}
+
+void BuildWatch::watchOnce(const std::chrono::milliseconds timeout)
+{
+    using std::chrono::milliseconds;
+
+    // Don't sleep past the point where we need to regenerate templates, or poll.
+    auto wait = timeout;
+    const auto wakeBy = [&wait](const milliseconds due) {
+        wait = wait < milliseconds::zero() ? due : std::min(wait, due);
+    };
+    if (const auto due = dirtyTemplates.timeUntilDue()) {
+        wakeBy(*due);
+    }
+    if (!polled.empty()) {
+        const auto untilPoll = std::chrono::ceil<milliseconds>(nextPoll - std::chrono::steady_clock::now());
+        wakeBy(std::max(untilPoll, milliseconds::zero()));
+    }
+
+    if (eventSource) {
+        eventSource->watchOnce(wait);
+    }
+
+    if (!polled.empty() && std::chrono::steady_clock::now() >= nextPoll) {
+        poll();
+    }
+
+    if (dirtyTemplates.due()) {
+        flush();
+    }
+}
+
+BuildWatch::PolledDirectory BuildWatch::pollState(const std::filesystem::path& directory) const
+{
+    // Errors give file_time_type::min(), which is fine, anything disappearing shows up as a change.
+    std::error_code ec;
+    PolledDirectory state{.modified = fs::last_write_time(directory, ec)};
+    for (const auto& templateFile : config.files) {
+        state.templatesModified.push_back(fs::last_write_time(directory / templateFile.src, ec));
+    }
+    return state;
+}
+
+void BuildWatch::startPolling(const std::vector<std::filesystem::path>& directories)
+{
+    if (polled.empty()) {
+        nextPoll = std::chrono::steady_clock::now() + config.pollInterval;
+    }
+    for (const auto& directory : directories) {
+        polled.insert_or_assign(directory.string(), pollState(directory));
+    }
+}
+
+void BuildWatch::stopPolling(const std::filesystem::path& directory)
+{
+    auto prefix = directory.string();
+    if (!prefix.ends_with('/')) {
+        prefix.push_back('/');
+    }
+    auto end = prefix;
+    end.back() = '/' + 1;
+
+    polled.erase(polled.lower_bound(prefix), polled.lower_bound(end));
+    polled.erase(directory.string());
+}
+
+void BuildWatch::poll()
+{
+    nextPoll = std::chrono::steady_clock::now() + config.pollInterval;
+
+    std::vector<fs::path> changed;
+    for (const auto& [directory, state] : polled) {
+        if (pollState(directory) != state) {
+            changed.emplace_back(directory);
+        }
+    }
+
+    // Rescanning a directory covers everything beneath it, so only rescan the top of each changed subtree.
+    std::set<fs::path> rescanned;
+    for (const auto& directory : changed) {
+        if (!isBeneath(directory, rescanned)) {
+            spdlog::debug("Polled directory changed, rescanning: {}", directory);
+            rescanned.insert(directory);
+
+            stopPolling(directory);
+            forgetDirectory(directory);
+            index.removeDirectory(directory);
+            templateCache.invalidateDirectory(directory);
+
+            // Watches what it can now, and polls the rest
+            if (fs::is_directory(directory)) {
+                scanDirectory(directory, true);
+            }
+        }
+
+        // The template owning the directory, and the one above, if the directory's template came or went
+        for (const auto& templateFile : config.files) {
+            if (const auto templatePath = index.findTemplate(directory, templateFile.src)) {
+                regenerate(templateFile, *templatePath);
+            }
+            if (const auto templatePath = index.findTemplate(directory.parent_path(), templateFile.src)) {
+                regenerate(templateFile, *templatePath);
+            }
+        }
+    }
+}
+
+BuildWatch::TemplateSources BuildWatch::templateSources() const
+{
+    TemplateSources result;
+    for (const auto& templateFile : config.files) {
+        for (const auto& templatePath : index.templatePaths(templateFile)) {
+            result.emplace(templatePath, index.files(templateFile, templatePath));
+        }
     }
+    return result;
 }
 
-void BuildWatch::watchOnce()
+void BuildWatch::resync()
 {
-    inotify.watchOnce();
+    spdlog::warn("Events were lost, rescanning {}", rootPath);
+
+    const auto before = templateSources();
+
+    // Start again, the (parallel) scan is the expensive part and we can't trust anything we have
+    index = FileIndex(config.files, rootPath);
+    directoryTimes.clear();
+    stopPolling(rootPath);
+    scanDirectory(rootPath, true, defaultThreadCount());
+
+    // Edits to templates we've read, that we didn't hear about
+    std::set<fs::path> changed;
+    for (auto& templatePath : templateCache.invalidateModified()) {
+        changed.insert(std::move(templatePath));
+    }
+
+    // Only those whose files changed, or are new, need regenerating.  Deleted templates affect the one above, so
+    // it'll show up here too.
+    for (auto& [templatePath, files] : templateSources()) {
+        if (const auto iter = before.find(templatePath); iter == before.end() || iter->second != files) {
+            changed.insert(templatePath);
+        }
+    }
+
+    spdlog::info("Rescanned, {} templates to regenerate", changed.size());
+    for (const auto& templatePath : changed) {
+        if (const auto& templateFile = config.findFilename(templatePath.filename().string());
+            templateFile && index.hasTemplate(templatePath)) {
+            regenerate(*templateFile, templatePath);
+        }
+    }
+}
+
+void BuildWatch::regenerate(const TemplateFile& templateFile, const std::filesystem::path& templatePath)
+{
+    spdlog::trace("Template marked dirty: {}", templatePath.string());
+    dirtyTemplates.add(templatePath, templateFile);
 }
 
-void BuildWatch::onCreateOrMoveFile(const inotify_event& event, const INotifyWatch& watch)
+void BuildWatch::flush()
 {
-    const auto path = watch.getDirectory() / event.name;
+    for (const auto& [templatePath, templateFile] : dirtyTemplates.take()) {
+        writeTemplate(templateFile, templatePath);
+    }
+}
+
+void BuildWatch::wake() const
+{
+    if (eventSource) {
+        eventSource->wake();
+    }
+}
+
+void BuildWatch::onCreateOrMoveFile(const FileEvent& event)
+{
+    const auto path = event.path();
 
     // Skip if we're not a file
     if (!fs::is_regular_file(path)) {
@@ -141,14 +513,18 @@ void BuildWatch::onCreateOrMoveFile(const inotify_event& event, const INotifyWat
         return;
     }
 
+    index.add(path);
+
     // Is it a new template file?
     if (const auto& templateFile = config.findFilename(event.name)) {
         spdlog::debug("Template created: {}", path.string());
-        writeTemplate(*templateFile, path);
+        // Could be an editor replacing it by renaming over the top
+        templateCache.invalidate(path);
+        regenerate(*templateFile, path);
 
-        if (const auto& templatePath = findUp(watch.getDirectory().parent_path(), templateFile->src, rootPath)) {
+        if (const auto& templatePath = index.findTemplate(event.directory.parent_path(), templateFile->src)) {
             spdlog::debug("Template creation also affects scope of parent template: {}", templatePath->string());
-            writeTemplate(*templateFile, *templatePath);
+            regenerate(*templateFile, *templatePath);
         }
         return;
     }
@@ -163,8 +539,8 @@ void BuildWatch::onCreateOrMoveFile(const inotify_event& event, const INotifyWat
         }
 
         // Is there a matching template file above this file?
-        if (const auto& templatePath = findUp(watch.getDirectory(), templateFile.src, rootPath)) {
-            writeTemplate(templateFile, *templatePath);
+        if (const auto& templatePath = index.findTemplate(event.directory, templateFile.src)) {
+            regenerate(templateFile, *templatePath);
             continue;
         }
 
@@ -172,34 +548,40 @@ void BuildWatch::onCreateOrMoveFile(const inotify_event& event, const INotifyWat
     }
 }
 
-void BuildWatch::onCreated(const inotify_event& event, const INotifyWatch& watch)
+void BuildWatch::onCreated(const FileEvent& event)
 {
-    const auto path = watch.getDirectory() / event.name;
+    const auto path = event.path();
 
     // Watch a new or moved directory
-    if (event.mask & IN_ISDIR) {
+    if (event.isDirectory) {
         spdlog::debug("Directory created {}", path.string());
         watchDirectory(path);
         return;
     }
 
-    onCreateOrMoveFile(event, watch);
+    onCreateOrMoveFile(event);
 }
 
-void BuildWatch::onDeleted(const inotify_event& event, const INotifyWatch& watch)
+void BuildWatch::onDeleted(const FileEvent& event)
 {
-    const auto path = watch.getDirectory() / event.name;
+    const auto path = event.path();
 
     // Do not watch any deleted or moved directories
-    if (event.mask & IN_ISDIR) {
-        inotify.remove(path);
+    if (event.isDirectory) {
+        eventSource->removeDirectory(path);
+        forgetDirectory(path);
+        index.removeDirectory(path);
+        templateCache.invalidateDirectory(path);
+        stopPolling(path);
         spdlog::debug("Directory deleted {}", path.string());
         return;
     }
 
+    index.remove(path);
+
     // Regenerate any files
     for (const auto& templateFile : config.files) {
-        const auto self = watch.getDirectory() / templateFile.src;
+        const auto self = event.directory / templateFile.src;
 
         if (!templateFile.hasExtension(path.extension()) && path != self) {
             spdlog::debug("File extension does not match this watcher: {} for {}", templateFile.src, path.string());
@@ -208,18 +590,20 @@ void BuildWatch::onDeleted(const inotify_event& event, const INotifyWatch& watch
 
         // Skip generated files from templates - leave it to the user to delete
         if (path == self) {
+            templateCache.invalidate(path);
             spdlog::warn("Template deleted, you might want to delete the generated file: {}", path.string());
-            if (const auto& templatePath = findUp(watch.getDirectory().parent_path(), templateFile.src, rootPath)) {
+            const auto parentDirectory = event.directory.parent_path();
+            if (const auto& templatePath = index.findTemplate(parentDirectory, templateFile.src)) {
                 spdlog::debug("Template deletion also affects scope of parent template: {}", templatePath->string());
-                writeTemplate(templateFile, *templatePath);
+                regenerate(templateFile, *templatePath);
             }
 
             continue;
         }
 
         // And is there a matching template file above it?
-        if (const auto& templatePath = findUp(watch.getDirectory(), templateFile.src, rootPath)) {
-            writeTemplate(templateFile, *templatePath);
+        if (const auto& templatePath = index.findTemplate(event.directory, templateFile.src)) {
+            regenerate(templateFile, *templatePath);
             continue;
         }
 
@@ -227,12 +611,12 @@ void BuildWatch::onDeleted(const inotify_event& event, const INotifyWatch& watch
     }
 }
 
-void BuildWatch::onModified(const inotify_event& event, const INotifyWatch& watch)
+void BuildWatch::onModified(const FileEvent& event)
 {
-    const auto path = watch.getDirectory() / event.name;
+    const auto path = event.path();
 
     // Watch a new or moved directory
-    if (event.mask & IN_ISDIR) {
+    if (event.isDirectory) {
         spdlog::warn("Weird, modified directory?? {}", path.string());
         return;
     }
@@ -244,169 +628,125 @@ void BuildWatch::onModified(const inotify_event& event, const INotifyWatch& watc
     }
 
     if (const auto& watcher = config.findFilename(event.name)) {
-        spdlog::debug("Template created: {}", path.string());
-        writeTemplate(*watcher, path);
+        spdlog::debug("Template modified: {}", path.string());
+        templateCache.invalidate(path);
+        regenerate(*watcher, path);
         return;
     }
 
     spdlog::trace("Modify event, but skipping: {}", path.string());
 }
 
-void BuildWatch::onMovedFrom(const inotify_event& event, const INotifyWatch& watch)
+void BuildWatch::onMovedFrom(const FileEvent& event)
 {
-    const auto path = watch.getDirectory() / event.name;
+    const auto path = event.path();
 
     // Watch a new or moved directory
-    if (event.mask & IN_ISDIR) {
-        inotify.moveFrom(path, event.cookie);
+    if (event.isDirectory) {
+        eventSource->movedFrom(path, event.cookie);
+        forgetDirectory(path);
+        index.removeDirectory(path);
+        templateCache.invalidateDirectory(path);
+        stopPolling(path);
         spdlog::debug("Directory moved from {}", path.string());
         return;
     }
 
-    onDeleted(event, watch);
+    onDeleted(event);
 }
 
-void BuildWatch::onMovedTo(const inotify_event& event, const INotifyWatch& watch)
+void BuildWatch::onMovedTo(const FileEvent& event)
 {
-    // Moved, add new watch
-    if (event.mask & IN_ISDIR) {
-        const auto path = watch.getDirectory() / event.name;
-        inotify.moveTo(path, event.cookie);
+    // Moved within the tree the watches come along, from outside it everything beneath needs watching
+    if (event.isDirectory) {
+        const auto path = event.path();
+        const auto watched = eventSource->movedTo(path, event.cookie);
+        scanDirectory(path, !watched);
         spdlog::debug("Directory moved to {}", path.string());
 
         for (const auto& templateFile : config.files) {
-            if (const auto& templatePath = findUp(path, templateFile.src, rootPath)) {
-                writeTemplate(templateFile, *templatePath);
+            if (const auto& templatePath = index.findTemplate(path, templateFile.src)) {
+                regenerate(templateFile, *templatePath);
             }
         }
     } else {
-        onCreateOrMoveFile(event, watch);
+        onCreateOrMoveFile(event);
     }
 }
 
-void BuildWatch::onEvent(const inotify_event& event, const INotifyWatch& watch)
+void BuildWatch::onEvent(const FileEvent& event)
 {
-    if (event.len) {
-        const auto path = watch.getDirectory() / event.name;
-
-        /// These must match what we asked for in inotify
-        spdlog::trace("Cookie={}  Event={}  Path={}", event.cookie, to_string(INotifyEvent{event.mask}), path.string());
-
-        if (event.mask & IN_CREATE) {
-            onCreated(event, watch);
-        }
-        if (event.mask & IN_DELETE) {
-            onDeleted(event, watch);
-        }
-        if (event.mask & IN_MODIFY) {
-            onModified(event, watch);
-        }
-        if (event.mask & IN_MOVED_FROM) {
-            onMovedFrom(event, watch);
-        }
-        if (event.mask & IN_MOVED_TO) {
-            onMovedTo(event, watch);
-        }
-    }
-}
-
-bool skipFileUnderDifferentTemplateFile(
-    std::vector<std::filesystem::path> const& nestedConfig, const std::filesystem::path& path)
-{
-    return std::ranges::any_of(nestedConfig, [&path](const auto& nestedTemplateFile) {
-        return path.parent_path().string().contains(nestedTemplateFile.parent_path().string());
-    });
-}
-
-std::vector<std::filesystem::path> getAllFiles(
-    const std::filesystem::path& templateFile,
-    const std::vector<std::string>& extensions,
-    const bool relativeToTemplate = true)
-{
-    namespace fs = std::filesystem;
-    namespace rv = std::ranges;
-
-    std::vector<fs::path> paths;
-
-    if (!fs::is_regular_file(templateFile)) {
-        throw std::runtime_error(fmt::format("Expected path to file as anchor: {}", templateFile.string()));
+    // Anything but a modification changes the directory's entries, so what we'd save for it is out of date
+    if (!config.stateFile.empty() && event.type != FileEvent::Type::Modified) {
+        untrust(event.directory);
     }
 
-    std::vector<fs::path> nestedConfig;
-    for (const auto& entry : fs::recursive_directory_iterator(templateFile.parent_path())) {
-        if (entry.is_regular_file() && entry.path().filename().string() == templateFile.filename().string()
-            && entry.path() != templateFile) {
-            nestedConfig.emplace_back(entry.path());
-        }
+    switch (event.type) {
+    case FileEvent::Type::Created:
+        onCreated(event);
+        break;
+    case FileEvent::Type::Deleted:
+        onDeleted(event);
+        break;
+    case FileEvent::Type::Modified:
+        onModified(event);
+        break;
+    case FileEvent::Type::MovedFrom:
+        onMovedFrom(event);
+        break;
+    case FileEvent::Type::MovedTo:
+        onMovedTo(event);
+        break;
+    case FileEvent::Type::Overflow:
+        resync();
+        break;
     }
-
-    for (const auto& entry : fs::recursive_directory_iterator(templateFile.parent_path())) {
-        if (!is_regular_file(entry.path()) || !rv::contains(extensions, entry.path().extension().string())) {
-            continue;
-        }
-
-        if (skipFileUnderDifferentTemplateFile(nestedConfig, entry.path())) {
-            spdlog::debug("Skipping file {} as it is within a nested template", entry.path().filename().string());
-            continue;
-        }
-
-        if (relativeToTemplate) {
-            paths.emplace_back(fs::relative(entry.path(), templateFile.parent_path()));
-        } else {
-            paths.emplace_back(entry.path());
-        }
-    }
-
-    // Return in sorted order
-    std::ranges::sort(paths, [](const std::filesystem::path& lhs, const std::filesystem::path& rhs) {
-        return lhs.string() < rhs.string();
-    });
-
-    return paths;
 }
 
 void BuildWatch::writeTemplate(const TemplateFile& templateFile, const std::filesystem::path& templatePath)
 {
-    // if (watcher.relativePaths) { files = btl::relative(files, templatePath.parent_path()); }
-    const auto destPath = templatePath.parent_path() / templateFile.dest;
-
-    spdlog::info("Reading {}", templatePath.string());
-    // https://github.com/kainjow/Mustache
+    auto destPath = templatePath.parent_path() / templateFile.dest;
 
-    std::ifstream istr(templatePath.string());
-    if (!istr) {
-        spdlog::error("Could not open template file {}", templatePath.string());
+    std::shared_ptr<Template> tmpl;
+    try {
+        tmpl = templateCache.get(templatePath);
+    } catch (const std::exception& ex) {
+        spdlog::error("Could not generate {} from {}: {}", destPath.string(), templatePath.string(), ex.what());
         return;
     }
 
-    std::stringstream str;
-    str << istr.rdbuf();                    // read the file
-    std::string templateString = str.str(); // str holds the content of the file
+    // Already sorted.  The index only changes on this thread, so the job gets its own copy.
+    auto files = index.files(templateFile, templatePath);
 
-    using namespace kainjow::mustache;
-    mustache tmpl(templateString);
-    data files{data::type::list};
+    // Keyed on where it's written, so two templates only render at once if they write different files
+    const auto key = destPath.string();
+    renderPool.submit(key, [this, tmpl = std::move(tmpl), files = std::move(files), templatePath, destPath] {
+        try {
+            const auto output = tmpl->render(files);
 
-    auto matchingFiles = getAllFiles(templatePath, templateFile.extensions);
-    std::ranges::sort(matchingFiles, [](const std::filesystem::path& lhs, const std::filesystem::path& rhs) {
-        return lhs.string() < rhs.string();
-    });
+            if (dryRun) {
+                std::scoped_lock lock(outputsMutex);
+                spdlog::info("Writing {}", destPath.string());
+                std::cout << output;
+                return;
+            }
 
-    for (const auto& file : matchingFiles) {
-        const bool isLast = (file == matchingFiles.back());
-        data d;
-        d.set("relpath", file.string());
-        d.set("last", data(isLast ? data::type::bool_true : data::type::bool_false));
-        files << d;
-    }
-    if (dryRun) {
-        spdlog::info("Writing {}", destPath.string());
-        tmpl.render({"files", files}, std::cout);
-    } else {
-        spdlog::info("Writing {}", destPath.string());
-        std::ofstream os(destPath);
-        tmpl.render({"files", files}, os);
-    }
+            // Only touch the file if it actually changes, otherwise we trigger needless reconfigures of the build.
+            if (writeIfChanged(destPath, output)) {
+                spdlog::info("Writing {}", destPath.string());
+            } else {
+                spdlog::debug("Unchanged, not writing {}", destPath.string());
+            }
+
+            if (!config.stateFile.empty()) {
+                auto state = outputState(templatePath, destPath, files);
+                std::scoped_lock lock(outputsMutex);
+                outputs.insert_or_assign(templatePath.string(), std::move(state));
+            }
+        } catch (const std::exception& ex) {
+            spdlog::error("Could not generate {} from {}: {}", destPath.string(), templatePath.string(), ex.what());
+        }
+    });
 }
 
-} // namespace btl
\ No newline at end of file
+} // namespace btl
@@ -23,12 +23,20 @@
 #pragma once
 
 #include <BuildWatch/Config.hpp>
-#include "INotify.hpp"
-#include "INotifyWatch.hpp"
+#include "Debouncer.hpp"
+#include "EventSource.hpp"
+#include "FileIndex.hpp"
 #include "Ignore.hpp"
+#include "RenderPool.hpp"
+#include "State.hpp"
+#include "TemplateCache.hpp"
+#include <chrono>
 #include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
-#include <sys/inotify.h>
+#include <vector>
 
 namespace btl {
 
@@ -49,38 +57,160 @@ public:
     /// @param dryRun whether to just print to stdout (and not write the build files)
     BuildWatch(const std::filesystem::path& rootDirectory, const Config& config, bool dryRun);
 
-    /// Destruction
-    ~BuildWatch() = default;
+    /// Destruction, writing the templates still queued and saving the state if `config.stateFile` is set
+    ~BuildWatch();
 
     /// Return the default configuration (that we print to stdout via `-g`)
     static std::string defaultConfig();
 
-    /// Process any pending notifications and return (non-blocking).
-    void watchOnce();
+    /// Process any pending notifications and return.
+    /// @param timeout how long to wait for notifications, zero (the default) is non-blocking, and
+    ///                `EventSource::infinite` blocks until there is an event or `wake` is called.
+    void watchOnce(std::chrono::milliseconds timeout = std::chrono::milliseconds::zero());
+
+    /// Wake up a thread blocked in `watchOnce`.  Safe to call from any thread.
+    void wake() const;
 
 private:
-    void onCreateOrMoveFile(const inotify_event& event, const INotifyWatch& watch);
-    void onCreated(const inotify_event& event, const INotifyWatch& watch);
-    void onDeleted(const inotify_event& event, const INotifyWatch& watch);
-    void onModified(const inotify_event& event, const INotifyWatch& watch);
-    void onMovedFrom(const inotify_event& event, const INotifyWatch& watch);
-    void onMovedTo(const inotify_event& event, const INotifyWatch& watch);
+    void onCreateOrMoveFile(const FileEvent& event);
+    void onCreated(const FileEvent& event);
+    void onDeleted(const FileEvent& event);
+    void onModified(const FileEvent& event);
+    void onMovedFrom(const FileEvent& event);
+    void onMovedTo(const FileEvent& event);
 
     /// Watch directory and sub-dirs
     void watchDirectory(const std::filesystem::path& directory);
 
-    void onEvent(const inotify_event& event, const INotifyWatch& watch);
+    /// Index the files in directory and sub-dirs, skipping ignored directories
+    /// @param directory the directory to walk
+    /// @param addWatches also ask the event source to watch each directory
+    /// @param threadCount threads to walk with, only worth more than one for the whole tree
+    void scanDirectory(const std::filesystem::path& directory, bool addWatches, std::size_t threadCount = 1);
+
+    /// Index the files in several directories and their sub-dirs, in one walk, skipping ignored directories
+    /// @param directories the directories to walk, not beneath one another unless `alsoSkip` prunes them
+    /// @param addWatches also ask the event source to watch each directory, in one batch
+    /// @param threadCount threads to walk with, only worth more than one for big scans
+    /// @param alsoSkip sub-directories to leave out, as well as the ignored ones.  Called from several threads.
+    /// @return every directory walked
+    std::vector<std::filesystem::path> scanDirectories(
+        const std::vector<std::filesystem::path>& directories,
+        bool addWatches,
+        std::size_t threadCount,
+        const SkipDirectory& alsoSkip = SkipDirectory{});
+
+    /// Ask the event source to watch the directories, and poll any it can't
+    void watch(const std::vector<std::filesystem::path>& directories);
+
+    /// Index and watch the tree from the saved state, rescanning only the directories that changed since it was saved,
+    /// and queue the templates that have changed for regeneration.
+    /// @return false if there is no usable state, so everything needs scanning
+    bool restore();
+
+    /// Save the state to `config.stateFile`, for the next `restore`
+    void save() const;
+
+    /// Digest of everything the saved state depends on, i.e. the root, config and ignore rules
+    [[nodiscard]] std::string fingerprint() const;
+
+    /// What the template is rendered from, and what it wrote
+    [[nodiscard]] State::Output outputState(
+        const std::filesystem::path& templatePath,
+        const std::filesystem::path& destPath,
+        const std::vector<std::filesystem::path>& files) const;
+
+    /// The directory's entries have changed, so its saved state would be out of date
+    void untrust(const std::filesystem::path& directory);
+
+    /// Drop the modification times of the directory, and everything beneath it
+    void forgetDirectory(const std::filesystem::path& directory);
+
+    /// Poll these directories, as we couldn't watch them
+    void startPolling(const std::vector<std::filesystem::path>& directories);
+
+    /// Stop polling the directory, and everything beneath it
+    void stopPolling(const std::filesystem::path& directory);
+
+    /// Check the polled directories, and rescan any that have changed
+    void poll();
+
+    /// Source files for each template, keyed on template path
+    using TemplateSources = std::map<std::filesystem::path, std::vector<std::filesystem::path>>;
+
+    /// What each template would be rendered from, according to the index
+    [[nodiscard]] TemplateSources templateSources() const;
+
+    /// We've lost events, so rescan the tree and regenerate the templates whose files (or content) changed
+    void resync();
+
+    /// Should we skip this directory, and everything beneath it?  Thread safe.
+    [[nodiscard]] bool isIgnored(const std::filesystem::path& directory) const;
 
+    void onEvent(const FileEvent& event);
+
+    /// Queue the template to be regenerated once events have gone quiet
+    void regenerate(const TemplateFile& templateFile, const std::filesystem::path& templatePath);
+
+    /// Regenerate all the queued templates
+    void flush();
+
+    /// Render the template, and write it out, on `renderPool`.  Whatever it needs from the index is copied here.
     void writeTemplate(const TemplateFile& templateFile, const std::filesystem::path& templatePath);
 
     std::filesystem::path rootPath{};
 
-    INotify inotify{};
+    /// Where the events come from, inotify or fanotify
+    std::unique_ptr<EventSource> eventSource{};
 
     Config config{};
 
     bool dryRun{};
 
     Ignore ignore{};
+
+    /// The .*ignore file in use, if any
+    std::filesystem::path ignorePath{};
+
+    /// Templates waiting to be regenerated, keyed on template path, so each is only written once per batch.
+    Debouncer<std::filesystem::path, TemplateFile> dirtyTemplates{};
+
+    /// Source and template files under `rootPath`, so we don't walk the tree on every regeneration, and which template
+    /// owns which directory, so events don't need `findUp`
+    FileIndex index{};
+
+    /// Parsed templates, dropped when the template changes
+    TemplateCache templateCache{};
+
+    /// What we know about a directory we're polling, if any of it changes the directory needs rescanning.
+    struct PolledDirectory
+    {
+        /// Changes when entries are added, removed or renamed
+        std::filesystem::file_time_type modified{};
+
+        /// Of the templates in the directory (in `config.files` order), as editing them doesn't change the directory
+        std::vector<std::filesystem::file_time_type> templatesModified{};
+
+        [[nodiscard]] bool operator==(const PolledDirectory&) const = default;
+    };
+
+    [[nodiscard]] PolledDirectory pollState(const std::filesystem::path& directory) const;
+
+    /// Directories the event source couldn't watch, e.g. we ran out of inotify watches, keyed on path
+    std::map<std::string, PolledDirectory> polled{};
+
+    std::chrono::steady_clock::time_point nextPoll{};
+
+    /// Modification times of the directories we've scanned, as of scanning, keyed on path.  Only kept if we're saving
+    /// state.  Set to `file_time_type::min()` once we see their entries change.
+    std::map<std::string, std::filesystem::file_time_type> directoryTimes{};
+
+    /// What each template was last rendered from, keyed on template path.  Only kept if we're saving state.
+    /// Also written by `renderPool`, so guarded by `outputsMutex`, as is stdout for `dryRun`.
+    std::map<std::string, State::Output> outputs{};
+    mutable std::mutex outputsMutex{};
+
+    /// Last, so it finishes before anything its jobs use goes away
+    RenderPool renderPool{};
 };
 } // namespace btl
\ No newline at end of file
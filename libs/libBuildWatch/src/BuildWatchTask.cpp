@@ -37,10 +37,11 @@ void BuildWatchTask::start(std::filesystem::path const& root, Config const& conf
         {
             spdlog::trace("Starting...");
             BuildWatch watcher(root, config, dryRun);
+            // Block in epoll until there's something to do, and get woken up when we're asked to stop.
+            const std::stop_callback wakeOnStop(token, [&watcher] { watcher.wake(); });
             while (!token.stop_requested()) {
-                watcher.watchOnce();
                 spdlog::trace("Waiting on task thread...");
-                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                watcher.watchOnce(EventSource::infinite);
             }
         }
         CPPTRACE_CATCH(std::exception const& ex)
@@ -30,6 +30,15 @@ void to_json(nlohmann::json& j, const Config& config)
     for (const auto& value : config.ignoreFiles) {
         j.at("ignoreFiles").push_back(value);
     }
+
+    j["readBufferSize"] = config.readBufferSize;
+    j["debounceMs"] = config.debounce.count();
+    j["maxLatencyMs"] = config.maxLatency.count();
+    j["maxWatches"] = config.maxWatches;
+    j["pollIntervalMs"] = config.pollInterval.count();
+    j["eventSource"] = config.eventSource;
+    j["stateFile"] = config.stateFile;
+    j["renderThreads"] = config.renderThreads;
 }
 
 void from_json(const nlohmann::json& j, Config& config)
@@ -43,6 +52,16 @@ void from_json(const nlohmann::json& j, Config& config)
     }
 
     config.ignoreFiles = j.at("ignoreFiles");
+
+    // Optional settings, keep the defaults if they're not supplied.
+    config.readBufferSize = j.value("readBufferSize", config.readBufferSize);
+    config.debounce = std::chrono::milliseconds(j.value("debounceMs", config.debounce.count()));
+    config.maxLatency = std::chrono::milliseconds(j.value("maxLatencyMs", config.maxLatency.count()));
+    config.maxWatches = j.value("maxWatches", config.maxWatches);
+    config.pollInterval = std::chrono::milliseconds(j.value("pollIntervalMs", config.pollInterval.count()));
+    config.eventSource = j.value("eventSource", config.eventSource);
+    config.stateFile = j.value("stateFile", config.stateFile);
+    config.renderThreads = j.value("renderThreads", config.renderThreads);
 }
 
 std::string to_string(const Config& config)
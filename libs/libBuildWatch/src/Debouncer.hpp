@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <optional>
+#include <vector>
+
+namespace btl {
+
+/// Collects work items until things have gone quiet, so that a burst of events is handled once.
+///
+/// A batch is due once nothing has been added for `quietPeriod`, or `maxLatency` after the first item was added,
+/// whichever comes first.  Items with the same key are coalesced, the latest value wins.
+template<typename Key, typename Value>
+class Debouncer
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    Debouncer() = default;
+
+    Debouncer(const std::chrono::milliseconds quietPeriod, const std::chrono::milliseconds maxLatency)
+        : quietPeriod(quietPeriod)
+        , maxLatency(std::max(maxLatency, quietPeriod))
+    {}
+
+    /// Add (or refresh) an item in the current batch
+    void add(const Key& key, const Value& value, const Clock::time_point now = Clock::now())
+    {
+        if (pending.empty()) {
+            firstAdded = now;
+        }
+        lastAdded = now;
+        pending.insert_or_assign(key, value);
+    }
+
+    /// @return true if nothing is waiting
+    [[nodiscard]] bool empty() const { return pending.empty(); }
+
+    /// @return how long until the current batch is due, or empty if there's nothing pending
+    [[nodiscard]] std::optional<std::chrono::milliseconds> timeUntilDue(
+        const Clock::time_point now = Clock::now()) const
+    {
+        if (pending.empty()) {
+            return std::nullopt;
+        }
+        const auto deadline = std::min(lastAdded + quietPeriod, firstAdded + maxLatency);
+        if (deadline <= now) {
+            return std::chrono::milliseconds::zero();
+        }
+        // Round up, otherwise we wake up a fraction too early and go straight back to sleep
+        return std::chrono::ceil<std::chrono::milliseconds>(deadline - now);
+    }
+
+    /// @return true if there's a batch waiting that should be handled now
+    [[nodiscard]] bool due(const Clock::time_point now = Clock::now()) const
+    {
+        const auto remaining = timeUntilDue(now);
+        return remaining && *remaining == std::chrono::milliseconds::zero();
+    }
+
+    /// Take the current batch, in key order, leaving the debouncer empty.
+    [[nodiscard]] std::vector<std::pair<Key, Value>> take()
+    {
+        std::vector<std::pair<Key, Value>> batch(
+            std::make_move_iterator(pending.begin()), std::make_move_iterator(pending.end()));
+        pending.clear();
+        return batch;
+    }
+
+private:
+    std::chrono::milliseconds quietPeriod{};
+    std::chrono::milliseconds maxLatency{};
+    Clock::time_point firstAdded{};
+    Clock::time_point lastAdded{};
+    std::map<Key, Value> pending{};
+};
+
+} // namespace btl
@@ -0,0 +1,287 @@
+/*
+ * Copyright (c) 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "Diff.hpp"
+#include <algorithm>
+#include <fmt/format.h>
+#include <vector>
+
+namespace {
+
+using Lines = std::vector<std::string_view>;
+
+/// Beyond this many differences we stop looking for the smallest diff, Myers needs O(D^2) memory
+constexpr int maxDifferences = 1000;
+
+enum class Op
+{
+    Equal,
+    Delete,
+    Insert,
+};
+
+struct Edit
+{
+    Op op{};
+
+    /// Line in `before`, for Equal and Delete
+    std::size_t before{};
+
+    /// Line in `after`, for Equal and Insert
+    std::size_t after{};
+};
+
+/// Each line keeps its newline, so a last line without one, or a line ending `\r\n`, differs from one ending `\n`
+Lines split(std::string_view text)
+{
+    Lines lines;
+    while (!text.empty()) {
+        const auto end = std::min(text.find('\n'), text.size() - 1) + 1;
+        lines.push_back(text.substr(0, end));
+        text.remove_prefix(end);
+    }
+    return lines;
+}
+
+/// Append a line of a hunk.  A carriage return would be invisible, so it's shown as `^M`, as `cat -v` does, and a
+/// missing newline is flagged as diff does.
+void appendLine(std::string& out, const char prefix, std::string_view line)
+{
+    const bool newline = line.ends_with('\n');
+    if (newline) {
+        line.remove_suffix(1);
+    }
+    const bool carriageReturn = line.ends_with('\r');
+    if (carriageReturn) {
+        line.remove_suffix(1);
+    }
+
+    fmt::format_to(std::back_inserter(out), "{}{}{}\n", prefix, line, carriageReturn ? "^M" : "");
+    if (!newline) {
+        out += "\\ No newline at end of file\n";
+    }
+}
+
+/// Myers' greedy O((N+M)D) algorithm over before[beforeBegin, beforeEnd) and after[afterBegin, afterEnd), appending
+/// the edits to `result`
+void middle(
+    const Lines& before,
+    const Lines& after,
+    const std::size_t beforeBegin,
+    const std::size_t beforeEnd,
+    const std::size_t afterBegin,
+    const std::size_t afterEnd,
+    std::vector<Edit>& result)
+{
+    const auto n = static_cast<int>(beforeEnd - beforeBegin);
+    const auto m = static_cast<int>(afterEnd - afterBegin);
+    const auto maxD = std::min(n + m, maxDifferences);
+    const auto offset = maxD + 1;
+    const auto equal = [&](const int x, const int y) { return before[beforeBegin + x] == after[afterBegin + y]; };
+
+    // v[k + offset] is the furthest x reached on diagonal k, trace holds v as it was before each step
+    std::vector<int> v(2 * static_cast<std::size_t>(maxD) + 3, 0);
+    std::vector<std::vector<int>> trace;
+    int found = -1;
+    for (int d = 0; d <= maxD && found < 0; ++d) {
+        trace.push_back(v);
+        for (int k = -d; k <= d; k += 2) {
+            int x = (k == -d || (k != d && v[k - 1 + offset] < v[k + 1 + offset])) ? v[k + 1 + offset]
+                                                                                  : v[k - 1 + offset] + 1;
+            int y = x - k;
+            while (x < n && y < m && equal(x, y)) {
+                ++x;
+                ++y;
+            }
+            v[k + offset] = x;
+            if (x >= n && y >= m) {
+                found = d;
+                break;
+            }
+        }
+    }
+
+    if (found < 0) {
+        // Too different to be worth it, replace the lot
+        for (int x = 0; x < n; ++x) {
+            result.push_back({.op = Op::Delete, .before = beforeBegin + x});
+        }
+        for (int y = 0; y < m; ++y) {
+            result.push_back({.op = Op::Insert, .after = afterBegin + y});
+        }
+        return;
+    }
+
+    // Walk back through the trace to find the path we took
+    std::vector<Edit> edits;
+    int x = n;
+    int y = m;
+    for (int d = found; d > 0; --d) {
+        const auto& previous = trace.at(d);
+        const int k = x - y;
+        const int previousK = (k == -d || (k != d && previous[k - 1 + offset] < previous[k + 1 + offset])) ? k + 1
+                                                                                                         : k - 1;
+        const int previousX = previous[previousK + offset];
+        const int previousY = previousX - previousK;
+        while (x > previousX && y > previousY) {
+            --x;
+            --y;
+            edits.push_back({Op::Equal, beforeBegin + x, afterBegin + y});
+        }
+        if (x == previousX) {
+            --y;
+            edits.push_back({.op = Op::Insert, .after = afterBegin + y});
+        } else {
+            --x;
+            edits.push_back({.op = Op::Delete, .before = beforeBegin + x});
+        }
+    }
+    while (x > 0 && y > 0) {
+        --x;
+        --y;
+        edits.push_back({Op::Equal, beforeBegin + x, afterBegin + y});
+    }
+
+    result.insert(result.end(), edits.rbegin(), edits.rend());
+}
+
+std::vector<Edit> edits(const Lines& before, const Lines& after)
+{
+    // Most changes are a few lines in a long file, so skip the common ends cheaply
+    std::size_t prefix = 0;
+    while (prefix < before.size() && prefix < after.size() && before[prefix] == after[prefix]) {
+        ++prefix;
+    }
+    std::size_t suffix = 0;
+    while (suffix < before.size() - prefix && suffix < after.size() - prefix
+           && before[before.size() - 1 - suffix] == after[after.size() - 1 - suffix]) {
+        ++suffix;
+    }
+
+    std::vector<Edit> result;
+    for (std::size_t i = 0; i < prefix; ++i) {
+        result.push_back({Op::Equal, i, i});
+    }
+    middle(before, after, prefix, before.size() - suffix, prefix, after.size() - suffix, result);
+    for (std::size_t i = suffix; i > 0; --i) {
+        result.push_back({Op::Equal, before.size() - i, after.size() - i});
+    }
+    return result;
+}
+
+/// As diff does, the start is the line before if the range is empty, and the length is left off if it's one
+std::string range(const std::size_t start, const std::size_t length)
+{
+    if (length == 1) {
+        return fmt::format("{}", start + 1);
+    }
+    return fmt::format("{},{}", length == 0 ? start : start + 1, length);
+}
+
+} // namespace
+
+namespace btl {
+
+Diff diffLines(
+    const std::string_view before,
+    const std::string_view after,
+    const std::string_view beforeName,
+    const std::string_view afterName,
+    const std::size_t context)
+{
+    const auto beforeLines = split(before);
+    const auto afterLines = split(after);
+    const auto script = edits(beforeLines, afterLines);
+
+    Diff diff;
+    std::size_t i = 0;
+    while (i < script.size()) {
+        // Next change
+        while (i < script.size() && script[i].op == Op::Equal) {
+            ++i;
+        }
+        if (i == script.size()) {
+            break;
+        }
+
+        // Take in following changes while they're close enough that their context would overlap
+        const auto first = i;
+        auto last = i;
+        for (std::size_t equalRun = 0; i < script.size(); ++i) {
+            if (script[i].op != Op::Equal) {
+                last = i;
+                equalRun = 0;
+            } else if (++equalRun > 2 * context) {
+                break;
+            }
+        }
+
+        const auto begin = first - std::min(first, context);
+        const auto end = std::min(script.size(), last + context + 1);
+
+        // Where the hunk starts in each file, i.e. how many lines come before it
+        std::size_t beforeStart = 0;
+        std::size_t afterStart = 0;
+        for (std::size_t j = 0; j < begin; ++j) {
+            beforeStart += script[j].op != Op::Insert;
+            afterStart += script[j].op != Op::Delete;
+        }
+
+        std::string lines;
+        std::size_t beforeLength = 0;
+        std::size_t afterLength = 0;
+        for (std::size_t j = begin; j < end; ++j) {
+            const auto& edit = script[j];
+            switch (edit.op) {
+            case Op::Equal:
+                appendLine(lines, ' ', beforeLines[edit.before]);
+                ++beforeLength;
+                ++afterLength;
+                break;
+            case Op::Delete:
+                appendLine(lines, '-', beforeLines[edit.before]);
+                ++beforeLength;
+                ++diff.removed;
+                break;
+            case Op::Insert:
+                appendLine(lines, '+', afterLines[edit.after]);
+                ++afterLength;
+                ++diff.added;
+                break;
+            }
+        }
+
+        if (diff.text.empty()) {
+            diff.text = fmt::format("--- {}\n+++ {}\n", beforeName, afterName);
+        }
+        fmt::format_to(
+            std::back_inserter(diff.text),
+            "@@ -{} +{} @@\n{}",
+            range(beforeStart, beforeLength),
+            range(afterStart, afterLength),
+            lines);
+        i = end;
+    }
+    return diff;
+}
+
+} // namespace btl
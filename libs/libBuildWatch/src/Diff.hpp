@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+#include <string>
+#include <string_view>
+
+namespace btl {
+
+/// Line by line differences between two texts
+struct Diff
+{
+    /// In unified format, like `diff -u`, empty if there are no differences.  Carriage returns at the end of lines are
+    /// shown as `^M`, so line ending differences are visible.
+    std::string text{};
+
+    std::size_t added{};
+    std::size_t removed{};
+};
+
+/// Compare two texts line by line, using Myers' algorithm, giving up on finding the smallest diff (and just replacing
+/// everything that differs) if they're wildly different.
+/// @param before the old text
+/// @param after the new text
+/// @param beforeName label for the old text, usually a path
+/// @param afterName label for the new text
+/// @param context lines of unchanged text around each change
+[[nodiscard]] Diff diffLines(
+    std::string_view before,
+    std::string_view after,
+    std::string_view beforeName,
+    std::string_view afterName,
+    std::size_t context = 3);
+
+} // namespace btl
@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+#include "MoveOnly.hpp"
+#include <cstring>
+#include <spdlog/spdlog.h>
+#include <sys/eventfd.h>
+#include <system_error>
+#include <unistd.h>
+
+namespace btl {
+
+/// RRID around eventfd, used to wake a thread blocked in `epoll_wait`.
+class EventFd
+{
+public:
+    EventFd()
+    {
+        fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (fd == -1) {
+            throw std::system_error(std::error_code{errno, std::system_category()});
+        }
+
+        spdlog::trace("EventFd::EventFd eventfd fd={}", fd.get());
+    }
+
+    ~EventFd()
+    {
+        spdlog::trace("EventFd::~EventFd Closing eventfd fd={}", fd.get());
+        close(fd);
+    }
+
+    /// Wake up anything polling this fd.  Safe to call from any thread.
+    void notify() const
+    {
+        constexpr eventfd_t one = 1;
+        if (eventfd_write(fd.get(), one) == -1) {
+            spdlog::warn("EventFd::notify eventfd_write failed: {}", strerror(errno));
+        }
+    }
+
+    /// Reset the counter so the fd is no longer readable.
+    void drain() const
+    {
+        eventfd_t value{};
+        (void) eventfd_read(fd.get(), &value);
+    }
+
+    /// You probably don't want to use this.  Do NOT close it.
+    [[nodiscard]] int getFd() const { return fd.get(); }
+
+private:
+    MoveOnly<int, -1> fd{};
+};
+
+} // namespace btl
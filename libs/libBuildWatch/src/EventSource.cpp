@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "EventSource.hpp"
+#include "FanotifyEventSource.hpp"
+#include "INotifyEventSource.hpp"
+#include <fmt/std.h>
+#include <spdlog/spdlog.h>
+#include <stdexcept>
+
+namespace btl {
+
+std::unique_ptr<EventSource> makeEventSource(
+    const Config& config,
+    const std::filesystem::path& root,
+    const SkipDirectory& skipDirectory,
+    const FileEventCallback& callback)
+{
+    if (config.eventSource == "fanotify") {
+        try {
+            auto source = std::make_unique<FanotifyEventSource>(config, root, skipDirectory, callback);
+            spdlog::info("Using fanotify for events");
+            return source;
+        } catch (const std::system_error& ex) {
+            spdlog::warn("Could not use fanotify, falling back to inotify: {}", ex.what());
+        }
+    } else if (config.eventSource != "inotify") {
+        throw std::invalid_argument(fmt::format("Unknown event source: {}", config.eventSource));
+    }
+
+    spdlog::info("Using inotify for events");
+    return std::make_unique<INotifyEventSource>(config, callback);
+}
+
+} // namespace btl
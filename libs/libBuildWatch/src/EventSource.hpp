@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "FileUtils.hpp"
+#include <BuildWatch/Config.hpp>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace btl {
+
+/// A change to the filesystem, independent of where it came from.
+struct FileEvent
+{
+    enum class Type
+    {
+        Created,
+        Deleted,
+        Modified,
+        MovedFrom,
+        MovedTo,
+        /// The source dropped events, e.g. its queue filled up.  Only the type is set, anything could have changed.
+        Overflow,
+    };
+
+    Type type{};
+
+    /// Is the thing that changed a directory?
+    bool isDirectory{};
+
+    /// The directory containing the thing that changed
+    std::filesystem::path directory{};
+
+    /// Name of the thing that changed, within `directory`
+    std::string name{};
+
+    /// Pairs up MovedFrom and MovedTo, if the source can.  Zero otherwise.
+    std::uint32_t cookie{};
+
+    [[nodiscard]] std::filesystem::path path() const { return directory / name; }
+};
+
+using FileEventCallback = std::function<void(const FileEvent&)>;
+
+/// What happened when we asked to watch a batch of directories
+struct WatchReport
+{
+    /// Directories we asked to watch
+    std::size_t requested{};
+
+    /// Watches we got
+    std::size_t obtained{};
+
+    /// Directories we couldn't watch, e.g. we hit `fs.inotify.max_user_watches`.  Directories that disappeared before
+    /// we got to them are neither obtained nor failed.
+    std::vector<std::filesystem::path> failed{};
+};
+
+/// Where BuildWatch gets its filesystem events from.
+///
+/// Some sources watch directory by directory (inotify), so need telling about every directory, and when they move or
+/// go.  Others watch the whole tree at once (fanotify), and can ignore all that.
+class EventSource
+{
+public:
+    /// Pass to `watchOnce` to block until there is an event, or `wake` is called.
+    static constexpr std::chrono::milliseconds infinite{-1};
+
+    virtual ~EventSource() = default;
+
+    /// Watch these directories, e.g. the result of a scan
+    /// @return which we're watching, and which we couldn't
+    virtual WatchReport addDirectories(const std::vector<std::filesystem::path>& directories) = 0;
+
+    /// Stop watching the directory, and everything beneath it
+    virtual void removeDirectory(const std::filesystem::path& directory) = 0;
+
+    /// A watched directory is being moved away, `cookie` matches the `movedTo` that follows
+    virtual void movedFrom(const std::filesystem::path& directory, std::uint32_t cookie) = 0;
+
+    /// A directory has arrived from elsewhere
+    /// @return false if the source needs it (and everything beneath) adding, as it came from outside what we watch
+    virtual bool movedTo(const std::filesystem::path& directory, std::uint32_t cookie) = 0;
+
+    /// Wait for events and pass them to the callback.
+    /// @param timeout zero returns straight away, `infinite` blocks until an event arrives or `wake` is called.
+    virtual void watchOnce(std::chrono::milliseconds timeout) = 0;
+
+    /// Wake a thread blocked in `watchOnce`.  Safe to call from any thread.
+    virtual void wake() const = 0;
+};
+
+/// Build the event source named in `config.eventSource`.  Asking for fanotify falls back to inotify if it isn't
+/// available, e.g. we don't have CAP_SYS_ADMIN or the kernel is too old.
+/// @param config settings
+/// @param root everything beneath here
+/// @param skipDirectory directories to leave alone, with everything beneath them
+/// @param callback called with each event
+[[nodiscard]] std::unique_ptr<EventSource> makeEventSource(
+    const Config& config,
+    const std::filesystem::path& root,
+    const SkipDirectory& skipDirectory,
+    const FileEventCallback& callback);
+
+} // namespace btl
@@ -0,0 +1,365 @@
+/*
+ * Copyright (c) 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "FanotifyEventSource.hpp"
+#include <array>
+#include <climits>
+#include <cstring>
+#include <fcntl.h>
+#include <fmt/std.h>
+#include <fstream>
+#include <optional>
+#include <spdlog/spdlog.h>
+#include <sstream>
+#include <sys/epoll.h>
+#include <sys/fanotify.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// What we watch the whole filesystem for, FAN_ONDIR so we hear about directories as well as files.  Not FAN_MODIFY,
+// every write anywhere on the filesystem would come through here, we only need it for templates, which get their own
+// marks.
+constexpr std::uint64_t eventMask = FAN_CREATE | FAN_DELETE | FAN_MOVED_FROM | FAN_MOVED_TO | FAN_ONDIR;
+
+/// The first mount point beneath `root`, if any.  The filesystem mark doesn't reach into them.
+std::optional<fs::path> findMountBeneath(const fs::path& root)
+{
+    auto prefix = root.string();
+    if (!prefix.ends_with('/')) {
+        prefix.push_back('/');
+    }
+
+    // "36 35 98:0 /mnt1 /mnt/parent rw,noatime master:1 - ext3 /dev/root rw", the mount point is the fifth field
+    std::ifstream mountInfo("/proc/self/mountinfo");
+    std::string line;
+    while (std::getline(mountInfo, line)) {
+        std::istringstream fields(line);
+        std::string field;
+        std::string mountPoint;
+        for (int i = 0; i < 5 && fields >> field; ++i) {
+            mountPoint = field;
+        }
+
+        // Spaces and the like are escaped as octal, e.g. \040
+        std::string unescaped;
+        for (std::size_t i = 0; i < mountPoint.size(); ++i) {
+            if (mountPoint[i] == '\\' && i + 3 < mountPoint.size()) {
+                unescaped.push_back(static_cast<char>(std::stoi(mountPoint.substr(i + 1, 3), nullptr, 8)));
+                i += 3;
+            } else {
+                unescaped.push_back(mountPoint[i]);
+            }
+        }
+        if (unescaped.starts_with(prefix)) {
+            return fs::path(unescaped);
+        }
+    }
+    return std::nullopt;
+}
+
+} // namespace
+
+namespace btl {
+
+FanotifyEventSource::FanotifyEventSource(
+    const Config& config, std::filesystem::path root, SkipDirectory skipDirectory, FileEventCallback callback)
+    // Events give us canonical directories, so they only match a canonical root
+    : root(fs::weakly_canonical(root))
+    , skipDirectory(std::move(skipDirectory))
+    , callback(std::move(callback))
+    , bufferSize(std::max(config.readBufferSize, sizeof(fanotify_event_metadata) + MAX_HANDLE_SZ + NAME_MAX + 64))
+    , buffer(std::make_unique_for_overwrite<char[]>(bufferSize))
+{
+    rootPrefix = this->root.string();
+    if (!rootPrefix.ends_with('/')) {
+        rootPrefix.push_back('/');
+    }
+
+    if (const auto mount = findMountBeneath(this->root)) {
+        throw std::system_error(
+            EXDEV, std::system_category(), fmt::format("{} is a separate mount, beneath {}", *mount, this->root));
+    }
+
+    for (const auto& templateFile : config.files) {
+        templateNames.insert(templateFile.src);
+    }
+
+    // We point fanotify_event_metadata* straight into the buffer.
+    static_assert(__STDCPP_DEFAULT_NEW_ALIGNMENT__ >= alignof(fanotify_event_metadata));
+
+    fanotifyFd = fanotify_init(FAN_CLASS_NOTIF | FAN_CLOEXEC | FAN_NONBLOCK | FAN_REPORT_DFID_NAME, O_RDONLY);
+    if (fanotifyFd == -1) {
+        throw std::system_error(errno, std::system_category(), "fanotify_init");
+    }
+
+    if (fanotify_mark(fanotifyFd, FAN_MARK_ADD | FAN_MARK_FILESYSTEM, eventMask, AT_FDCWD, this->root.c_str()) == -1) {
+        const auto error = errno;
+        close(fanotifyFd);
+        throw std::system_error(error, std::system_category(), fmt::format("fanotify_mark {}", this->root));
+    }
+
+    mountFd = open(this->root.c_str(), O_DIRECTORY | O_RDONLY | O_CLOEXEC);
+    if (mountFd == -1) {
+        const auto error = errno;
+        close(fanotifyFd);
+        throw std::system_error(error, std::system_category(), fmt::format("open {}", this->root));
+    }
+
+    epoll.add(fanotifyFd);
+    epoll.add(wakeFd.getFd());
+
+    spdlog::trace("FanotifyEventSource::FanotifyEventSource fanotify fd={} root={}", fanotifyFd.get(), this->root);
+}
+
+FanotifyEventSource::~FanotifyEventSource()
+{
+    spdlog::trace("FanotifyEventSource::~FanotifyEventSource Closing fanotify fd={}", fanotifyFd.get());
+    close(mountFd);
+    close(fanotifyFd);
+}
+
+WatchReport FanotifyEventSource::addDirectories(const std::vector<std::filesystem::path>& directories)
+{
+    // The filesystem mark covers the directories, but edits to templates need their own
+    for (const auto& directory : directories) {
+        for (const auto& name : templateNames) {
+            markTemplate(directory / name);
+        }
+    }
+    return {.requested = directories.size(), .obtained = directories.size()};
+}
+
+void FanotifyEventSource::markTemplate(const std::filesystem::path& path)
+{
+    // Follows the file, so a template replaced by a rename needs marking again, which its MovedTo does
+    if (fanotify_mark(fanotifyFd, FAN_MARK_ADD, FAN_MODIFY, AT_FDCWD, path.c_str()) == 0) {
+        spdlog::trace("Fanotify: watching template {}", path);
+    } else if (errno != ENOENT) {
+        spdlog::warn("Fanotify: could not watch template {}: {}", path, strerror(errno));
+    }
+}
+
+void FanotifyEventSource::removeDirectory(const std::filesystem::path& directory)
+{
+    // Could be recreated as something we do want, or don't
+    auto prefix = directory.string();
+    if (!prefix.ends_with('/')) {
+        prefix.push_back('/');
+    }
+    std::erase_if(wanted, [&](const auto& entry) {
+        return entry.first == directory.string() || entry.first.starts_with(prefix);
+    });
+}
+
+void FanotifyEventSource::movedFrom(const std::filesystem::path& directory, std::uint32_t)
+{
+    removeDirectory(directory);
+}
+
+bool FanotifyEventSource::movedTo(const std::filesystem::path& directory, std::uint32_t)
+{
+    // The filesystem mark covers it, but templates moved in from outside the tree need marking
+    removeDirectory(directory);
+    return false;
+}
+
+void FanotifyEventSource::watchOnce(const std::chrono::milliseconds timeout)
+{
+    std::array<epoll_event, 2> events{};
+    const auto eventCount = epoll_wait(epoll.fd(), events.data(), events.size(), static_cast<int>(timeout.count()));
+    if (eventCount < 0) {
+        if (errno != EINTR) {
+            spdlog::error("epoll_wait: {}", strerror(errno));
+        }
+        return;
+    }
+    for (int i = 0; i < eventCount; ++i) {
+        if (events.at(i).data.fd == wakeFd.getFd()) {
+            spdlog::trace("Fanotify: woken up");
+            wakeFd.drain();
+            continue;
+        }
+        processEvents();
+    }
+}
+
+void FanotifyEventSource::wake() const
+{
+    wakeFd.notify();
+}
+
+std::optional<std::filesystem::path> FanotifyEventSource::resolve(file_handle& handle)
+{
+    // The raw handle identifies the directory, so it only needs turning into a path once
+    std::string key(reinterpret_cast<const char*>(&handle.handle_type), sizeof(handle.handle_type));
+    key.append(reinterpret_cast<const char*>(handle.f_handle), handle.handle_bytes);
+    if (const auto iter = resolved.find(key); iter != resolved.end()) {
+        return iter->second;
+    }
+
+    const int fd = open_by_handle_at(mountFd.get(), &handle, O_PATH | O_CLOEXEC);
+    if (fd == -1) {
+        // ESTALE, it's already gone
+        spdlog::trace("Fanotify: could not open directory handle: {}", strerror(errno));
+        return std::nullopt;
+    }
+
+    std::array<char, PATH_MAX> path{};
+    const auto length = readlink(fmt::format("/proc/self/fd/{}", fd).c_str(), path.data(), path.size());
+    close(fd);
+    if (length <= 0) {
+        return std::nullopt;
+    }
+
+    if (resolved.size() >= maxResolved) {
+        resolved.clear();
+    }
+    return resolved.emplace(std::move(key), fs::path(std::string(path.data(), length))).first->second;
+}
+
+bool FanotifyEventSource::isWanted(const std::filesystem::path& directory)
+{
+    // The mark covers the whole filesystem, so most directories aren't ours.  Not worth remembering.
+    const auto& name = directory.string();
+    if (name != root.string() && !name.starts_with(rootPrefix)) {
+        return false;
+    }
+
+    if (const auto iter = wanted.find(name); iter != wanted.end()) {
+        return iter->second;
+    }
+
+    // Neither it nor anything between it and the root skipped.
+    bool result = true;
+    for (auto path = directory; path != root && path != path.parent_path(); path = path.parent_path()) {
+        if (skipDirectory && skipDirectory(path)) {
+            result = false;
+            break;
+        }
+    }
+
+    // Cheaper to start again than to track what's least used
+    if (wanted.size() >= maxWanted) {
+        wanted.clear();
+    }
+    wanted.emplace(name, result);
+    return result;
+}
+
+void FanotifyEventSource::processEvents()
+{
+    while (true) {
+        const auto length = read(fanotifyFd, buffer.get(), bufferSize);
+        if (length < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                spdlog::warn("Fanotify: read() failed: {}", strerror(errno));
+            }
+            return; // Drained
+        }
+
+        auto remaining = length;
+        for (auto metadata = reinterpret_cast<const fanotify_event_metadata*>(buffer.get());
+             FAN_EVENT_OK(metadata, remaining);
+             metadata = FAN_EVENT_NEXT(metadata, remaining)) {
+            if (metadata->vers != FANOTIFY_METADATA_VERSION) {
+                spdlog::error("Fanotify: unexpected metadata version {}", metadata->vers);
+                return;
+            }
+            if (metadata->mask & FAN_Q_OVERFLOW) {
+                spdlog::warn("Fanotify: event queue overflowed, events have been lost");
+                callback({.type = FileEvent::Type::Overflow});
+                continue;
+            }
+
+            // With FAN_REPORT_DFID_NAME there's no fd, but a directory handle and a name.
+            const auto info = reinterpret_cast<const fanotify_event_info_fid*>(metadata + 1);
+            if (info->hdr.info_type != FAN_EVENT_INFO_TYPE_DFID_NAME) {
+                continue;
+            }
+            auto& handle = *reinterpret_cast<file_handle*>(const_cast<unsigned char*>(info->handle));
+            const std::string name = reinterpret_cast<const char*>(handle.f_handle + handle.handle_bytes);
+            if (name.empty() || name == ".") {
+                continue;
+            }
+
+            const auto directory = resolve(handle);
+            if (!directory || !isWanted(*directory)) {
+                continue;
+            }
+
+            const auto emit = [&](const FileEvent::Type type) {
+                spdlog::trace("Fanotify: event={} path={}", static_cast<int>(type), (*directory / name).string());
+                callback({
+                    .type = type,
+                    .isDirectory = (metadata->mask & FAN_ONDIR) != 0,
+                    .directory = *directory,
+                    .name = name,
+                });
+            };
+
+            // Queued events for the same name are merged into one mask, which loses their order, e.g. a save that
+            // renames the old file away and writes a new one.  So removals go first, and then only what's there now.
+            using enum FileEvent::Type;
+            constexpr std::array removals = {std::pair{FAN_DELETE, Deleted}, std::pair{FAN_MOVED_FROM, MovedFrom}};
+            constexpr std::array arrivals = {
+                std::pair{FAN_CREATE, Created},
+                std::pair{FAN_MOVED_TO, MovedTo},
+                std::pair{FAN_MODIFY, Modified},
+            };
+            bool present = true;
+            for (const auto& [mask, type] : removals) {
+                if (metadata->mask & mask) {
+                    emit(type);
+                    present = false;
+                }
+            }
+            if (!present && (metadata->mask & (FAN_CREATE | FAN_MOVED_TO | FAN_MODIFY))) {
+                struct stat status{};
+                present = lstat((*directory / name).c_str(), &status) == 0;
+            }
+            for (const auto& [mask, type] : arrivals) {
+                if (present && (metadata->mask & mask)) {
+                    emit(type);
+                }
+            }
+
+            if (metadata->mask & FAN_ONDIR) {
+                // Whatever was resolved beneath it now has the wrong path, or none
+                if (metadata->mask & (FAN_DELETE | FAN_MOVED_FROM | FAN_MOVED_TO)) {
+                    resolved.clear();
+                }
+            } else if (present && (metadata->mask & (FAN_CREATE | FAN_MOVED_TO)) && templateNames.contains(name)) {
+                markTemplate(*directory / name);
+            }
+        }
+    }
+}
+
+} // namespace btl
@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "Epoll.hpp"
+#include "EventFd.hpp"
+#include "EventSource.hpp"
+#include "MoveOnly.hpp"
+#include <memory>
+#include <optional>
+#include <set>
+#include <string>
+#include <unordered_map>
+
+struct file_handle;
+
+namespace btl {
+
+/// Events from fanotify, which watches the whole filesystem with a single mark, so there's no per directory setup or
+/// kernel memory.  We filter out anything outside the root, or in skipped directories.  Modifications are only watched
+/// for on the templates, with a mark each, otherwise every write to the filesystem would wake us.
+///
+/// Needs Linux 5.9+ (for `FAN_REPORT_DFID_NAME` with create/delete/move events) and CAP_SYS_ADMIN (for
+/// `FAN_MARK_FILESYSTEM`) as well as CAP_DAC_READ_SEARCH (to turn the directory handles we're given back into paths).
+/// The constructor throws if we can't have it, or if something is mounted beneath the root, as the mark doesn't reach
+/// into other filesystems.
+class FanotifyEventSource : public EventSource
+{
+public:
+    /// @param config for the read buffer size
+    /// @param root where to watch from
+    /// @param skipDirectory directories to leave alone, with everything beneath them
+    /// @param callback called with each event
+    FanotifyEventSource(
+        const Config& config, std::filesystem::path root, SkipDirectory skipDirectory, FileEventCallback callback);
+
+    ~FanotifyEventSource() override;
+
+    /// The mark covers every directory already.
+    WatchReport addDirectories(const std::vector<std::filesystem::path>& directories) override;
+    void removeDirectory(const std::filesystem::path& directory) override;
+    void movedFrom(const std::filesystem::path& directory, std::uint32_t cookie) override;
+    bool movedTo(const std::filesystem::path& directory, std::uint32_t cookie) override;
+    void watchOnce(std::chrono::milliseconds timeout) override;
+    void wake() const override;
+
+private:
+    /// Read and dispatch events until the fanotify fd would block.
+    void processEvents();
+
+    /// Turn a directory handle from an event into a path, empty if the directory has gone.  Memoised in `resolved`.
+    [[nodiscard]] std::optional<std::filesystem::path> resolve(file_handle& handle);
+
+    /// Watch the template for modifications, if it exists
+    void markTemplate(const std::filesystem::path& path);
+
+    /// Is the directory under the root, and not skipped?
+    [[nodiscard]] bool isWanted(const std::filesystem::path& directory);
+
+    std::filesystem::path root{};
+    /// `root` with a trailing slash, to tell what's beneath it
+    std::string rootPrefix{};
+    SkipDirectory skipDirectory{};
+
+    /// Names of the template files, from the config
+    std::set<std::string> templateNames{};
+    FileEventCallback callback{};
+
+    MoveOnly<int, -1> fanotifyFd{};
+
+    /// Any fd on the filesystem, for `open_by_handle_at`
+    MoveOnly<int, -1> mountFd{};
+
+    /// Most directory handles `resolved` holds, before we start it again
+    static constexpr std::size_t maxResolved{64 * 1024};
+
+    /// Raw directory handle -> path, dropped whenever a directory moves or goes
+    std::unordered_map<std::string, std::filesystem::path> resolved{};
+
+    /// Most directories `wanted` holds, before we start it again
+    static constexpr std::size_t maxWanted{64 * 1024};
+
+    /// Memo of `isWanted`, as the same directories turn up over and over.  Only those under the root.
+    std::unordered_map<std::string, bool> wanted{};
+
+    std::size_t bufferSize{};
+    std::unique_ptr<char[]> buffer{};
+
+    EventFd wakeFd{};
+    Epoll epoll{};
+};
+
+} // namespace btl
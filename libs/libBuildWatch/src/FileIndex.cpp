@@ -0,0 +1,231 @@
+/*
+ * Copyright (c) 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "FileIndex.hpp"
+#include <algorithm>
+#include <ranges>
+#include <spdlog/spdlog.h>
+
+namespace fs = std::filesystem;
+namespace rg = std::ranges;
+
+namespace {
+
+/// Everything beneath `directory` sorts in [directoryPrefix(directory), directoryEnd(directory))
+std::string directoryPrefix(const fs::path& directory)
+{
+    auto prefix = directory.string();
+    if (!prefix.ends_with('/')) {
+        prefix.push_back('/');
+    }
+    return prefix;
+}
+
+std::string directoryEnd(const fs::path& directory)
+{
+    auto end = directoryPrefix(directory);
+    end.back() = '/' + 1;
+    return end;
+}
+
+} // namespace
+
+namespace btl {
+
+FileIndex::FileIndex(std::vector<TemplateFile> templates, std::filesystem::path rootPath)
+    : templates(std::move(templates))
+    , rootPath(std::move(rootPath))
+{
+    for (const auto& templateFile : this->templates) {
+        extensions.insert(templateFile.extensions.begin(), templateFile.extensions.end());
+        templateDirectories[templateFile.src];
+    }
+}
+
+bool FileIndex::isSource(const std::filesystem::path& path) const
+{
+    return extensions.contains(path.extension().string());
+}
+
+bool FileIndex::isTemplate(const std::filesystem::path& path) const
+{
+    return templateDirectories.contains(path.filename().string());
+}
+
+void FileIndex::add(const std::filesystem::path& path)
+{
+    if (isTemplate(path)) {
+        spdlog::trace("FileIndex: adding template {}", path.string());
+        const auto src = path.filename().string();
+        if (templateDirectories.at(src).insert(path.parent_path().string()).second) {
+            nearest[src].clear();
+        }
+    }
+    if (isSource(path)) {
+        sources.insert(path.string());
+    }
+}
+
+void FileIndex::remove(const std::filesystem::path& path)
+{
+    if (isTemplate(path)) {
+        spdlog::trace("FileIndex: removing template {}", path.string());
+        const auto src = path.filename().string();
+        if (templateDirectories.at(src).erase(path.parent_path().string())) {
+            nearest[src].clear();
+        }
+    }
+    sources.erase(path.string());
+}
+
+void FileIndex::removeDirectory(const std::filesystem::path& directory)
+{
+    const auto begin = directoryPrefix(directory);
+    const auto end = directoryEnd(directory);
+
+    sources.erase(sources.lower_bound(begin), sources.lower_bound(end));
+    for (auto& [src, directories] : templateDirectories) {
+        const auto first = directories.lower_bound(begin);
+        const auto last = directories.lower_bound(end);
+        auto& memo = nearest[src];
+        if (first != last || directories.contains(directory.string())) {
+            directories.erase(first, last);
+            directories.erase(directory.string());
+            memo.clear();
+        } else {
+            // Still right, but the directories have gone
+            std::erase_if(memo, [&](const auto& entry) {
+                return entry.first == directory.string() || entry.first.starts_with(begin);
+            });
+        }
+    }
+}
+
+std::vector<std::filesystem::path> FileIndex::paths() const
+{
+    std::set<std::string> result(sources);
+    for (const auto& [src, directories] : templateDirectories) {
+        for (const auto& directory : directories) {
+            result.insert((fs::path(directory) / src).string());
+        }
+    }
+    return {result.begin(), result.end()};
+}
+
+std::vector<std::filesystem::path> FileIndex::templatePaths(const TemplateFile& templateFile) const
+{
+    std::vector<fs::path> result;
+    if (const auto iter = templateDirectories.find(templateFile.src); iter != templateDirectories.end()) {
+        for (const auto& directory : iter->second) {
+            result.push_back(fs::path(directory) / templateFile.src);
+        }
+    }
+    return result;
+}
+
+bool FileIndex::hasTemplate(const std::filesystem::path& templatePath) const
+{
+    const auto iter = templateDirectories.find(templatePath.filename().string());
+    return iter != templateDirectories.end() && iter->second.contains(templatePath.parent_path().string());
+}
+
+std::vector<std::filesystem::path> FileIndex::files(
+    const TemplateFile& templateFile, const std::filesystem::path& templatePath) const
+{
+    const auto directory = templatePath.parent_path();
+    const auto prefix = directoryPrefix(directory);
+    const auto end = directoryEnd(directory);
+
+    // Nested templates of the same kind, in sorted order, so we can skip over them as we go.
+    std::vector<std::string> nested;
+    if (const auto iter = templateDirectories.find(templateFile.src); iter != templateDirectories.end()) {
+        const auto& directories = iter->second;
+        for (auto dir = directories.lower_bound(prefix); dir != directories.lower_bound(end); ++dir) {
+            nested.push_back(directoryPrefix(*dir));
+        }
+    }
+    auto nextNested = nested.begin();
+
+    std::vector<fs::path> result;
+    auto iter = sources.lower_bound(prefix);
+    const auto last = sources.lower_bound(end);
+    while (iter != last) {
+        const auto& source = *iter;
+
+        while (nextNested != nested.end() && *nextNested < source && !source.starts_with(*nextNested)) {
+            ++nextNested;
+        }
+        if (nextNested != nested.end() && source.starts_with(*nextNested)) {
+            // Jump past everything owned by the nested template
+            spdlog::trace("FileIndex: skipping files within nested template {}", *nextNested);
+            iter = sources.lower_bound(directoryEnd(nextNested->substr(0, nextNested->size() - 1)));
+            continue;
+        }
+
+        if (rg::contains(templateFile.extensions, fs::path(source).extension().string())) {
+            result.emplace_back(source.substr(prefix.size()));
+        }
+        ++iter;
+    }
+
+    return result;
+}
+
+std::optional<std::filesystem::path> FileIndex::findTemplate(
+    const std::filesystem::path& directory, const std::string& src)
+{
+    const auto iter = templateDirectories.find(src);
+    if (iter == templateDirectories.end()) {
+        return std::nullopt;
+    }
+    const auto& directories = iter->second;
+    auto& memo = nearest[src];
+
+    if (const auto known = memo.find(directory.string()); known != memo.end()) {
+        return known->second;
+    }
+
+    // Walk up until we find a template, or a directory we already know the answer for.
+    std::vector<std::string> visited;
+    std::optional<fs::path> result;
+    for (auto path = directory; path != rootPath && path != path.parent_path(); path = path.parent_path()) {
+        auto dir = path.string();
+        if (const auto known = memo.find(dir); known != memo.end()) {
+            result = known->second;
+            break;
+        }
+        if (directories.contains(dir)) {
+            result = path / src;
+            visited.push_back(std::move(dir));
+            break;
+        }
+        visited.push_back(std::move(dir));
+    }
+
+    spdlog::trace("FileIndex: {} for {} is {}", src, directory.string(), result ? result->string() : "none");
+    for (auto& dir : visited) {
+        memo.emplace(std::move(dir), result);
+    }
+    return result;
+}
+
+} // namespace btl
@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <BuildWatch/Config.hpp>
+#include <filesystem>
+#include <map>
+#include <optional>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace btl {
+
+/// In-memory index of the source files and template files under the watched tree, so that we can list the files
+/// belonging to a template without walking the filesystem.
+///
+/// Populated once by walking the tree, then kept up to date from the inotify events.  Paths are absolute and kept
+/// sorted, so the files belonging to a template directory are a contiguous range, and nested templates of the same
+/// kind are sub-ranges that get skipped.
+///
+/// Also finds the template owning a directory, memoising directory -> nearest template.  The memo for a template name
+/// is thrown away whenever one of those templates is added or removed, which is rare compared to source file events.
+class FileIndex
+{
+public:
+    FileIndex() = default;
+
+    /// @param templates the template files (and their extensions) we're indexing for
+    /// @param rootPath the watched root, `findTemplate` never looks at or above it.  Empty to look all the way up.
+    explicit FileIndex(std::vector<TemplateFile> templates, std::filesystem::path rootPath = {});
+
+    /// Add a file.  Ignored unless it's a template or has one of the extensions we care about.
+    void add(const std::filesystem::path& path);
+
+    /// Remove a file, if indexed.
+    void remove(const std::filesystem::path& path);
+
+    /// Remove everything indexed beneath `directory`.
+    void removeDirectory(const std::filesystem::path& directory);
+
+    /// Files belonging to the template, i.e. matching its extensions and not beneath a nested template of the same
+    /// name.  Sorted.
+    /// @param templateFile the template configuration
+    /// @param templatePath absolute path to the template file
+    /// @return paths relative to the template's directory
+    [[nodiscard]] std::vector<std::filesystem::path> files(
+        const TemplateFile& templateFile, const std::filesystem::path& templatePath) const;
+
+    /// Every indexed file, sources and templates.  Sorted.
+    [[nodiscard]] std::vector<std::filesystem::path> paths() const;
+
+    /// Paths to every indexed template of the given kind.  Sorted.
+    /// @param templateFile the template configuration
+    [[nodiscard]] std::vector<std::filesystem::path> templatePaths(const TemplateFile& templateFile) const;
+
+    /// Is the given template file indexed?
+    [[nodiscard]] bool hasTemplate(const std::filesystem::path& templatePath) const;
+
+    /// Find the nearest template named `src` in `directory` or above it.  Equivalent to `findUp(directory, src,
+    /// rootPath)`, without the syscalls.
+    /// @param directory where to start looking
+    /// @param src template file name
+    /// @return path to the template, empty if there isn't one
+    [[nodiscard]] std::optional<std::filesystem::path> findTemplate(
+        const std::filesystem::path& directory, const std::string& src);
+
+    /// Number of source files indexed
+    [[nodiscard]] std::size_t size() const { return sources.size(); }
+
+private:
+    /// Would we ever want this file in a template?
+    [[nodiscard]] bool isSource(const std::filesystem::path& path) const;
+
+    /// Is the file one of our templates?
+    [[nodiscard]] bool isTemplate(const std::filesystem::path& path) const;
+
+    std::vector<TemplateFile> templates{};
+
+    std::filesystem::path rootPath{};
+
+    /// Union of all template extensions
+    std::set<std::string> extensions{};
+
+    /// Source files
+    std::set<std::string> sources{};
+
+    /// Template name (src) -> directories containing that template
+    std::map<std::string, std::set<std::string>> templateDirectories{};
+
+    /// Template name (src) -> memo of directory -> nearest template
+    std::map<std::string, std::unordered_map<std::string, std::optional<std::filesystem::path>>> nearest{};
+};
+
+} // namespace btl
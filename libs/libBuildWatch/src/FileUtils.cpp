@@ -22,7 +22,73 @@
 
 #include "FileUtils.hpp"
 #include <algorithm>
+#include <fmt/std.h>
+#include <fstream>
 #include <spdlog/spdlog.h>
+#include <unistd.h>
+
+namespace {
+/// Append the files beneath `directory` to `paths`, in sorted order, stopping at any directory (other than the top)
+/// that has its own template.
+void collectFiles(
+    const std::filesystem::path& directory,
+    const std::filesystem::path& relativeDirectory,
+    const std::filesystem::path& templateName,
+    const std::vector<std::string>& extensions,
+    const bool relativeToTemplate,
+    const btl::SkipDirectory& skipDirectory,
+    std::vector<std::filesystem::path>& paths)
+{
+    namespace fs = std::filesystem;
+
+    struct Entry
+    {
+        /// Sorts the same as the full path would, i.e. directories have a trailing `/`
+        std::string key;
+        fs::directory_entry entry;
+        bool isDirectory;
+    };
+
+    const bool isTop = relativeDirectory.empty();
+    std::vector<Entry> entries;
+    for (const auto& entry : fs::directory_iterator(directory)) {
+        const bool isDirectory = entry.is_directory() && !entry.is_symlink();
+        if (!isTop && !isDirectory && entry.path().filename() == templateName && entry.is_regular_file()) {
+            spdlog::debug("Skipping directory {} as it has a nested template", directory.string());
+            return;
+        }
+        auto key = entry.path().filename().string();
+        if (isDirectory) {
+            key.push_back('/');
+        }
+        entries.push_back({std::move(key), entry, isDirectory});
+    }
+    std::ranges::sort(entries, {}, &Entry::key);
+
+    for (const auto& [key, entry, isDirectory] : entries) {
+        const auto relativePath = relativeDirectory / entry.path().filename();
+        if (isDirectory) {
+            if (!skipDirectory || !skipDirectory(entry.path())) {
+                collectFiles(
+                    entry.path(), relativePath, templateName, extensions, relativeToTemplate, skipDirectory, paths);
+            }
+        } else if (entry.is_regular_file() && std::ranges::contains(extensions, entry.path().extension().string())) {
+            paths.push_back(relativeToTemplate ? relativePath : entry.path());
+        }
+    }
+}
+
+/// If the iterator is on a directory we should skip, stop it descending into it and return true.
+bool prune(std::filesystem::recursive_directory_iterator& iter, const btl::SkipDirectory& skipDirectory)
+{
+    if (skipDirectory && iter->is_directory() && skipDirectory(iter->path())) {
+        iter.disable_recursion_pending();
+        return true;
+    }
+    return false;
+}
+
+} // namespace
 
 namespace btl {
 
@@ -74,20 +140,119 @@ bool hasExtension(const std::vector<std::string>& extensions, const std::filesys
 }
 
 std::vector<std::filesystem::path> findAll(
-    const std::filesystem::path& rootDirectory, const std::vector<std::string>& extensions)
+    const std::filesystem::path& rootDirectory,
+    const std::vector<std::string>& extensions,
+    const SkipDirectory& skipDirectory)
 {
     namespace fs = std::filesystem;
     namespace rv = std::ranges;
 
     std::vector<std::filesystem::path> result;
 
-    for (const auto& entry : fs::recursive_directory_iterator(rootDirectory)) {
-        if (is_regular_file(entry.path()) && rv::contains(extensions, entry.path().extension().string())) {
-            result.push_back(entry.path());
+    for (auto iter = fs::recursive_directory_iterator(rootDirectory); iter != fs::recursive_directory_iterator();
+         ++iter) {
+        if (prune(iter, skipDirectory)) {
+            continue;
+        }
+        if (is_regular_file(iter->path()) && rv::contains(extensions, iter->path().extension().string())) {
+            result.push_back(iter->path());
         }
     }
 
     return result;
 }
 
-}
\ No newline at end of file
+std::vector<std::filesystem::path> getAllFiles(
+    const std::filesystem::path& templateFile,
+    const std::vector<std::string>& extensions,
+    const bool relativeToTemplate,
+    const SkipDirectory& skipDirectory)
+{
+    namespace fs = std::filesystem;
+
+    if (!fs::is_regular_file(templateFile)) {
+        throw std::runtime_error(fmt::format("Expected path to file as anchor: {}", templateFile.string()));
+    }
+
+    // One pass, visiting each directory's entries in sorted order, so there's nothing to sort or filter afterwards.
+    std::vector<fs::path> paths;
+    collectFiles(
+        templateFile.parent_path(),
+        fs::path{},
+        templateFile.filename(),
+        extensions,
+        relativeToTemplate,
+        skipDirectory,
+        paths);
+    return paths;
+}
+
+bool hasContent(const std::filesystem::path& path, const std::string_view content)
+{
+    std::error_code ec;
+    if (const auto size = std::filesystem::file_size(path, ec); ec || size != content.size()) {
+        return false;
+    }
+
+    std::ifstream is(path, std::ios::binary);
+    std::string existing(content.size(), '\0');
+    if (!is.read(existing.data(), static_cast<std::streamsize>(existing.size()))) {
+        return false;
+    }
+    return existing == content;
+}
+
+bool writeIfChanged(const std::filesystem::path& path, const std::string_view content)
+{
+    namespace fs = std::filesystem;
+
+    if (hasContent(path, content)) {
+        return false;
+    }
+
+    const auto tempPath = path.parent_path() / fmt::format(".{}.{}.tmp", path.filename().string(), getpid());
+    {
+        std::ofstream os(tempPath, std::ios::binary | std::ios::trunc);
+        os.write(content.data(), static_cast<std::streamsize>(content.size()));
+        if (!os.flush()) {
+            std::error_code ignored;
+            fs::remove(tempPath, ignored);
+            throw std::runtime_error(fmt::format("Failed to write {}", tempPath));
+        }
+    }
+
+    // Keep the permissions of the file we're replacing
+    if (std::error_code ec; fs::exists(path, ec)) {
+        fs::permissions(tempPath, fs::status(path).permissions(), ec);
+    }
+
+    std::error_code ec;
+    fs::rename(tempPath, path, ec);
+    if (ec) {
+        std::error_code ignored;
+        fs::remove(tempPath, ignored);
+        throw std::system_error(ec, fmt::format("Failed to rename {} to {}", tempPath, path));
+    }
+    return true;
+}
+
+std::string readFile(const std::filesystem::path& path)
+{
+    std::ifstream is(path, std::ios::binary);
+    if (!is) {
+        throw std::runtime_error(fmt::format("Could not open {}", path));
+    }
+
+    std::string content;
+    std::error_code ec;
+    if (const auto size = std::filesystem::file_size(path, ec); !ec) {
+        content.reserve(size);
+    }
+    content.assign(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>());
+    if (is.bad()) {
+        throw std::runtime_error(fmt::format("Could not read {}", path));
+    }
+    return content;
+}
+
+} // namespace btl
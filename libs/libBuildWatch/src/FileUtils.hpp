@@ -22,10 +22,16 @@
 
 #pragma once
 #include <filesystem>
+#include <functional>
+#include <string>
+#include <string_view>
 #include <vector>
 
 namespace btl {
 
+/// Return true to skip a directory, and everything beneath it, when walking a tree.
+using SkipDirectory = std::function<bool(const std::filesystem::path&)>;
+
 /// Walk *up* the directory tree looking for `pathToFind` until we hit the root, or go 'up' too many times
 ///
 /// @param path starting directory
@@ -58,8 +64,42 @@ namespace btl {
 /// Find all files under the `rootDirectory` that have the given extensions
 /// @param rootDirectory
 /// @param extensions extensions MUST start with a dot, i.e. `.`
+/// @param skipDirectory optional, directories it returns true for are not descended into
 /// @return
 [[nodiscard]] std::vector<std::filesystem::path> findAll(
-    const std::filesystem::path& rootDirectory, const std::vector<std::string>& extensions);
+    const std::filesystem::path& rootDirectory,
+    const std::vector<std::string>& extensions,
+    const SkipDirectory& skipDirectory = {});
+
+/// Find all the files that belong to a template file by walking the filesystem, i.e. files beneath the template's
+/// directory with the given extensions, skipping any beneath a nested template of the same name.
+/// @param templateFile path to the template file
+/// @param extensions extensions MUST start with a dot, i.e. `.`
+/// @param relativeToTemplate return paths relative to the template's directory, otherwise absolute paths
+/// @param skipDirectory optional, directories it returns true for are not descended into
+/// @return the files, sorted
+[[nodiscard]] std::vector<std::filesystem::path> getAllFiles(
+    const std::filesystem::path& templateFile,
+    const std::vector<std::string>& extensions,
+    bool relativeToTemplate = true,
+    const SkipDirectory& skipDirectory = {});
+
+/// Does the file at `path` contain exactly `content`?  False if it can't be read.
+/// @param path file to compare
+/// @param content what we expect
+[[nodiscard]] bool hasContent(const std::filesystem::path& path, std::string_view content);
+
+/// Write `content` to `path`, unless the file already has exactly that content, in which case it's left alone (and so
+/// is its modification time).  Writes to a temporary file alongside `path` and renames it over the top, so nobody sees
+/// a half written file.  Throws on failure.
+/// @param path file to write
+/// @param content what the file should contain
+/// @return true if the file was written, false if it was already up to date
+bool writeIfChanged(const std::filesystem::path& path, std::string_view content);
+
+/// Read the whole of a file.  Throws on failure.
+/// @param path file to read
+/// @return the file's content
+[[nodiscard]] std::string readFile(const std::filesystem::path& path);
 
-} // namespace btl
\ No newline at end of file
+} // namespace btl
@@ -0,0 +1,245 @@
+/*
+ * Copyright (c) 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "FilesTemplate.hpp"
+#include <algorithm>
+#include <cctype>
+
+namespace {
+
+constexpr std::string_view open = "{{";
+constexpr std::string_view close = "}}";
+constexpr std::string_view closeUnescaped = "}}}";
+
+std::string_view trim(std::string_view text)
+{
+    const auto isSpace = [](const char ch) { return std::isspace(static_cast<unsigned char>(ch)) != 0; };
+    while (!text.empty() && isSpace(text.front())) {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && isSpace(text.back())) {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+/// Lines with section tags on them are dropped if this is true, as kainjow does
+bool isBlank(const std::string_view line)
+{
+    return std::ranges::all_of(line, [](const char ch) { return ch == ' ' || ch == '\t'; });
+}
+
+/// Same as kainjow's html_escape
+void appendEscaped(std::string& output, const std::string_view text)
+{
+    for (const auto ch : text) {
+        switch (ch) {
+        case '&':
+            output.append("&amp;");
+            break;
+        case '<':
+            output.append("&lt;");
+            break;
+        case '>':
+            output.append("&gt;");
+            break;
+        case '"':
+            output.append("&quot;");
+            break;
+        case '\'':
+            output.append("&apos;");
+            break;
+        default:
+            output.push_back(ch);
+            break;
+        }
+    }
+}
+
+} // namespace
+
+namespace btl {
+
+std::optional<FilesTemplate> FilesTemplate::compile(const std::string_view content)
+{
+    using Kind = Node::Kind;
+
+    FilesTemplate result;
+
+    // The sections we're in, innermost last.  Only ever files, then last.
+    std::vector<Node*> sections;
+    const auto current = [&]() -> std::vector<Node>& {
+        return sections.empty() ? result.nodes : sections.back()->children;
+    };
+    const auto inside = [&](const Kind kind) { return !sections.empty() && sections.back()->kind == kind; };
+    const auto insideFiles = [&] { return !sections.empty() && sections.front()->kind == Kind::Files; };
+
+    std::string text;
+    const auto addText = [&] {
+        if (!text.empty()) {
+            if (insideFiles()) {
+                result.textPerFile += text.size();
+            }
+            current().push_back({.kind = Kind::Text, .text = std::move(text)});
+            text.clear();
+        }
+    };
+
+    std::size_t position = 0;
+    while (position < content.size()) {
+        const auto rest = content.substr(position);
+
+        if (rest.starts_with(open)) {
+            addText();
+
+            const bool unescaped = rest.size() > open.size() && rest[open.size()] == '{';
+            const auto contentsStart = open.size() + (unescaped ? 1 : 0);
+            const auto end = rest.find(unescaped ? closeUnescaped : close, contentsStart);
+            if (end == std::string_view::npos) {
+                return std::nullopt;
+            }
+            position += end + (unescaped ? closeUnescaped : close).size();
+
+            const auto tag = trim(rest.substr(contentsStart, end - contentsStart));
+            if (tag.empty()) {
+                return std::nullopt;
+            }
+            const auto name = trim(tag.substr(1));
+
+            if (unescaped || tag.front() == '&') {
+                if ((unescaped ? tag : name) != "relpath" || !insideFiles()) {
+                    return std::nullopt;
+                }
+                current().push_back({.kind = Kind::RelPath, .escape = false});
+            } else if (tag.front() == '!') {
+                // Comment, renders nothing
+            } else if (tag.front() == '#' || tag.front() == '^') {
+                if (name == "files" && tag.front() == '#' && sections.empty()) {
+                    current().push_back({.kind = Kind::Files});
+                } else if (name == "last" && inside(Kind::Files)) {
+                    current().push_back({.kind = Kind::Last, .inverted = tag.front() == '^'});
+                } else {
+                    return std::nullopt;
+                }
+                sections.push_back(&current().back());
+            } else if (tag.front() == '/') {
+                if (sections.empty() || name != (inside(Kind::Files) ? "files" : "last")) {
+                    return std::nullopt;
+                }
+                sections.pop_back();
+            } else if (tag == "relpath" && insideFiles()) {
+                current().push_back({.kind = Kind::RelPath, .escape = true});
+            } else {
+                // Other variables, partials, set delimiters...
+                return std::nullopt;
+            }
+            continue;
+        }
+
+        if (rest.starts_with("\r\n") || rest.front() == '\n' || rest.front() == '\r') {
+            addText();
+            const auto length = rest.starts_with("\r\n") ? 2 : 1;
+            if (insideFiles()) {
+                result.textPerFile += length;
+            }
+            current().push_back({.kind = Kind::Newline, .text = std::string(rest.substr(0, length))});
+            position += length;
+            continue;
+        }
+
+        text.push_back(rest.front());
+        ++position;
+    }
+    addText();
+
+    if (!sections.empty()) {
+        return std::nullopt;
+    }
+    return result;
+}
+
+void FilesTemplate::render(const std::vector<std::filesystem::path>& files, std::string& output) const
+{
+    std::size_t size = output.size() + textPerFile * files.size();
+    for (const auto& file : files) {
+        size += file.native().size();
+    }
+    output.reserve(size);
+
+    Line line;
+    render(nodes, files, 0, line, output);
+
+    // Last line, that has no newline
+    if (!line.sectionTag || !isBlank(line.text)) {
+        output.append(line.text);
+    }
+}
+
+void FilesTemplate::render(
+    const std::vector<Node>& nodes,
+    const std::vector<std::filesystem::path>& files,
+    const std::size_t index,
+    Line& line,
+    std::string& output) const
+{
+    using Kind = Node::Kind;
+
+    for (const auto& node : nodes) {
+        switch (node.kind) {
+        case Kind::Text:
+            line.text.append(node.text);
+            break;
+        case Kind::Newline:
+            // Lines holding nothing but section tags (and whitespace) vanish
+            if (!line.sectionTag || !isBlank(line.text)) {
+                output.append(line.text);
+                output.append(node.text);
+            }
+            line.text.clear();
+            line.sectionTag = false;
+            break;
+        case Kind::RelPath:
+            if (node.escape) {
+                appendEscaped(line.text, files[index].native());
+            } else {
+                line.text.append(files[index].native());
+            }
+            break;
+        case Kind::Files:
+            for (std::size_t i = 0; i < files.size(); ++i) {
+                line.sectionTag = true;
+                render(node.children, files, i, line, output);
+                line.sectionTag = true;
+            }
+            break;
+        case Kind::Last:
+            if ((index + 1 == files.size()) != node.inverted) {
+                line.sectionTag = true;
+                render(node.children, files, index, line, output);
+                line.sectionTag = true;
+            }
+            break;
+        }
+    }
+}
+
+} // namespace btl
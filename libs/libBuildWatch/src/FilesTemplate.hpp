@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace btl {
+
+/// Renders the subset of mustache that nearly all our templates use, i.e. literal text plus
+/// `{{#files}}...{{relpath}}...{{^last}}...{{/last}}...{{/files}}`, straight from the list of files into one output
+/// buffer, without building a mustache data tree per file.
+///
+/// Output is identical to kainjow mustache, including HTML escaping of `{{relpath}}` and its rules for dropping lines
+/// that only hold section tags.  `compile` returns nothing for anything outside the subset, and the caller falls back
+/// to the full implementation.
+class FilesTemplate
+{
+public:
+    /// @param content the template text
+    /// @return the compiled template, or empty if it uses anything we don't handle
+    [[nodiscard]] static std::optional<FilesTemplate> compile(std::string_view content);
+
+    /// Render the template, appending to `output`
+    /// @param files the files, in the order they should appear
+    /// @param output where to write
+    void render(const std::vector<std::filesystem::path>& files, std::string& output) const;
+
+private:
+    struct Node
+    {
+        enum class Kind
+        {
+            Text,
+            Newline,
+            RelPath,
+            Files,
+            Last,
+        };
+
+        Kind kind{};
+
+        /// Literal text, for Text and Newline
+        std::string text{};
+
+        /// For RelPath, whether to HTML escape it
+        bool escape{};
+
+        /// For Last, whether it's `{{^last}}`
+        bool inverted{};
+
+        /// Contents of the Files and Last sections
+        std::vector<Node> children{};
+    };
+
+    /// What kainjow calls the line buffer, we can only decide whether to output a line once we reach its end
+    struct Line
+    {
+        std::string text{};
+
+        /// Rendered a section tag on this line, so drop it if it's otherwise blank
+        bool sectionTag{};
+    };
+
+    void render(
+        const std::vector<Node>& nodes,
+        const std::vector<std::filesystem::path>& files,
+        std::size_t index,
+        Line& line,
+        std::string& output) const;
+
+    std::vector<Node> nodes{};
+
+    /// Literal text that's output once per file, so we can size the output up front
+    std::size_t textPerFile{};
+};
+
+} // namespace btl
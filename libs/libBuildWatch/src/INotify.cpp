@@ -23,61 +23,135 @@
 #include "INotify.hpp"
 #include "INotifyWatch.hpp"
 #include <algorithm>
+#include <array>
+#include <climits>
+#include <cstring>
 #include <fmt/std.h>
+#include <fstream>
 #include <spdlog/spdlog.h>
+#include <stdexcept>
 #include <sys/epoll.h>
 #include <sys/inotify.h>
+#include <system_error>
 #include <unistd.h>
 #include <utility>
 
-namespace rg = std::ranges;
 namespace fs = std::filesystem;
 
 namespace btl {
 
-void INotify::addWatch(std::filesystem::path const& directory, const INotifyCallback& callback)
+bool INotify::addWatch(std::filesystem::path const& directory)
 {
     // These flags must match what we're watching
-    addWatch(directory, IN_CREATE | IN_DELETE | IN_MODIFY | IN_MOVED_TO | IN_MOVED_FROM, callback);
+    return addWatch(directory, IN_CREATE | IN_DELETE | IN_MODIFY | IN_MOVED_TO | IN_MOVED_FROM);
 }
 
-void INotify::addWatch(std::filesystem::path const& directory, int flags, const INotifyCallback& callback)
+bool INotify::addWatch(std::filesystem::path const& directory, int flags)
 {
-    watches.emplace_back(std::make_unique<INotifyWatch>(inotifyWrapper.getFd(), directory, flags, callback));
+    if (!fs::is_directory(directory)) {
+        throw std::runtime_error(fmt::format("Path is not a directory: {}", directory));
+    }
+
+    const auto wd = inotify_add_watch(inotifyWrapper.getFd(), directory.c_str(), flags);
+    if (wd == -1) {
+        throw std::system_error(errno, std::system_category());
+    }
+
+    if (const auto existing = registry.find(wd); existing != WatchRegistry::none) {
+        // inotify_add_watch returns the same wd for a directory that is already watched.
+        spdlog::trace("INotify: directory already watched wd={} dir={}", wd, directory);
+        if (registry.directory(existing) != directory) {
+            registry.move(existing, directory);
+        }
+        registry.setFlags(existing, flags);
+        return false;
+    }
+
+    registry.add(wd, directory, flags);
+    spdlog::trace("INotify: added inotify watch wd={} dir={}", wd, directory);
+    return true;
+}
+
+WatchReport INotify::addWatches(std::vector<std::filesystem::path> const& directories)
+{
+    WatchReport report{.requested = directories.size()};
+
+    auto count = watchCount();
+    bool exhausted = false;
+    for (const auto& directory : directories) {
+        if (maxWatches && count >= maxWatches && !exhausted) {
+            spdlog::warn("INotify: reached our limit of {} watches: {}", maxWatches, directory);
+            exhausted = true;
+        }
+        // Once we've hit the limit there's no point asking for more
+        if (exhausted) {
+            report.failed.push_back(directory);
+            continue;
+        }
+
+        spdlog::debug("Watching subdir: {}", directory);
+        try {
+            if (addWatch(directory)) {
+                ++count;
+            }
+            ++report.obtained;
+        } catch (const std::system_error& ex) {
+            if (ex.code() == std::errc::no_space_on_device) {
+                spdlog::warn("INotify: out of watches after {} directories: {}", report.obtained, directory);
+                exhausted = true;
+                report.failed.push_back(directory);
+            } else if (ex.code() == std::errc::no_such_file_or_directory) {
+                spdlog::debug("INotify: directory went before we could watch it: {}", directory);
+            } else {
+                spdlog::warn("INotify: could not watch {}: {}", directory, ex.what());
+                report.failed.push_back(directory);
+            }
+        } catch (const std::runtime_error& ex) {
+            // No longer a directory
+            spdlog::debug("INotify: {}", ex.what());
+        }
+    }
+    return report;
 }
 
-void INotify::remove(const INotifyWatch& watch)
+std::optional<std::size_t> INotify::maxUserWatches()
 {
-    std::erase_if(watches, [&watch](const auto& other) { return *other == watch; });
+    std::ifstream is("/proc/sys/fs/inotify/max_user_watches");
+    if (std::size_t limit{}; is >> limit) {
+        return limit;
+    }
+    return std::nullopt;
 }
 
 void INotify::remove(const std::filesystem::path& directory)
 {
     // Remove any subdirectories watched as well, obviously.
-    const auto e = rg::remove_if(watches, [&directory](const auto& pWatch) {
-        fs::path p = pWatch->getDirectory();
-        const auto root = p.root_path();
-        while (p != root) {
-            if (p == directory) {
-                return true;
-            }
-            p = p.parent_path();
-        }
-        return false;
-    });
+    if (const auto index = registry.find(directory); index != WatchRegistry::none) {
+        removeSubtree(index);
+    }
+}
 
-    watches.erase(e.begin(), e.end());
+void INotify::removeSubtree(const std::uint32_t index)
+{
+    for (const auto wd : registry.removeSubtree(index)) {
+        // Fails harmlessly if the kernel already dropped it, i.e. the directory was deleted
+        inotify_rm_watch(inotifyWrapper.getFd(), wd);
+        spdlog::trace("INotify: removed inotify watch wd={}", wd);
+    }
 }
 
-void INotify::moveTo(std::filesystem::path const& directory, std::uint32_t cookie)
+bool INotify::moveTo(std::filesystem::path const& directory, std::uint32_t cookie)
 {
-    const auto cookieIter = rg::find_if(watches, [&cookie](const auto& pWatch) { return pWatch->cookie == cookie; });
-    if (cookieIter != watches.end()) {
-        spdlog::trace("Watch cookie {} exists, setting directory: {}", cookie, directory.string());
-        (*cookieIter)->directory = directory;
-    } else {
-        spdlog::debug("Watch cookie {} not found", cookie);
+    if (const auto wd = moves.take(cookie)) {
+        if (const auto index = registry.find(*wd); index != WatchRegistry::none) {
+            // Just the one watch moves, everything beneath it comes along
+            spdlog::trace("Watch cookie {} exists, setting directory: {}", cookie, directory.string());
+            registry.move(index, directory);
+            return true;
+        }
     }
+    spdlog::debug("Directory moved in from elsewhere, cookie {}: {}", cookie, directory);
+    return false;
 }
 
 void INotify::moveFrom(std::filesystem::path const& directory, std::uint32_t cookie)
@@ -87,21 +161,39 @@ void INotify::moveFrom(std::filesystem::path const& directory, std::uint32_t coo
     //  Generates an IN_MOVED_FROM  event  for  dir1,  an  IN_MOVED_TO  event  for  dir2,  and  an
     //  IN_MOVE_SELF  event  for  myfile.   The IN_MOVED_FROM and IN_MOVED_TO events will have the
     //  same cookie value.
-    const auto directoryIter = rg::find_if(watches, [&directory](const auto& pWatch) {
-        return pWatch->directory == directory;
-    });
-    if (directoryIter != watches.end()) {
-        spdlog::trace("Directory exists, setting cookie to {}: {}", cookie, directory.string());
-        (*directoryIter)->cookie = cookie;
+    if (const auto index = registry.find(directory); index != WatchRegistry::none) {
+        spdlog::trace("Directory exists, waiting for cookie {}: {}", cookie, directory.string());
+        moves.add(cookie, registry.wd(index));
     } else {
         spdlog::debug("Moved-from directory not watched: {}", directory);
     }
 }
 
-void INotify::watchOnce()
+void INotify::expireMoves()
 {
-    std::vector<epoll_event> events(10);
-    const auto eventCount = epoll_wait(epoll.fd(), events.data(), events.size(), 0);
+    for (const auto wd : moves.expire()) {
+        if (const auto index = registry.find(wd); index != WatchRegistry::none) {
+            spdlog::debug("Directory moved out of the tree: {}", registry.directory(index));
+            removeSubtree(index);
+        }
+    }
+}
+
+std::size_t INotify::watchCount() const
+{
+    return registry.size();
+}
+
+void INotify::watchOnce(const std::chrono::milliseconds timeout)
+{
+    // Don't sleep past a pending move expiring
+    auto wait = timeout;
+    if (const auto expiry = moves.timeUntilExpiry()) {
+        wait = wait < std::chrono::milliseconds::zero() ? *expiry : std::min(wait, *expiry);
+    }
+
+    std::array<epoll_event, 2> events{};
+    const auto eventCount = epoll_wait(epoll.fd(), events.data(), events.size(), static_cast<int>(wait.count()));
     if (eventCount < 0) {
         if (errno == EINTR) {
             return; // Interrupted by signal, retry
@@ -110,44 +202,129 @@ void INotify::watchOnce()
         return;
     }
     for (int i = 0; i < eventCount; ++i) {
-        processEvent();
+        if (events.at(i).data.fd == wakeFd.getFd()) {
+            spdlog::trace("INotify: woken up");
+            wakeFd.drain();
+            continue;
+        }
+        // Before taking from the ring, so anything queued after this comes with another notify
+        readyFd.drain();
+        processEvents();
     }
+
+    expireMoves();
 }
 
-INotify::INotify()
+void INotify::wake() const
 {
-    epoll.add(inotifyWrapper.getFd());
+    wakeFd.notify();
 }
 
-void INotify::processEvent()
+INotify::INotify(const std::size_t bufferSize, const std::size_t maxWatches)
+    // Must be able to hold at least one event with the longest name, otherwise read() fails with EINVAL.
+    : bufferSize(std::max(bufferSize, sizeof(inotify_event) + NAME_MAX + 1))
+    , buffer(std::make_unique_for_overwrite<char[]>(this->bufferSize))
+    , maxWatches(maxWatches)
 {
-    constexpr std::int64_t eventSize = sizeof(struct inotify_event);
-    constexpr std::int64_t bufferSize = 1024 * (eventSize + 16);
+    // We point inotify_event* straight into the buffer.
+    static_assert(__STDCPP_DEFAULT_NEW_ALIGNMENT__ >= alignof(inotify_event));
 
-    std::vector<char> buffer(bufferSize);
+    epoll.add(readyFd.getFd());
+    epoll.add(wakeFd.getFd());
 
-    const auto length = read(inotifyWrapper.getFd(), buffer.data(), buffer.size());
-    if (length < 0) {
-        spdlog::warn("INotify: read() failed: {}", strerror(errno));
-        return;
+    reader = std::jthread([this] { readEvents(); });
+}
+
+INotify::~INotify()
+{
+    stopping = true;
+    stopFd.notify();
+
+    // Make room, in case the reader is waiting for some
+    INotifyRecord record;
+    while (ring.tryPop(record)) {
     }
+    reader.join();
+}
 
-    std::int64_t i = 0;
-    while (i < length) {
-        const auto pEvent = reinterpret_cast<struct inotify_event*>(&buffer.at(i));
-        if (pEvent) {
-            // Yes, linear search, for now
-            const auto iter = rg::find_if(watches, [pEvent](const auto& other) { return other->wd == pEvent->wd; });
-            if (iter != watches.end()) {
-                (*iter)->onEvent(*pEvent);
-            } else {
-                spdlog::warn("INotify: unknown wd = {}", pEvent->wd);
+void INotify::readEvents()
+{
+    Epoll readerEpoll;
+    readerEpoll.add(inotifyWrapper.getFd());
+    readerEpoll.add(stopFd.getFd());
+
+    while (!stopping) {
+        std::array<epoll_event, 2> events{};
+        const auto eventCount = epoll_wait(readerEpoll.fd(), events.data(), events.size(), -1);
+        if (eventCount < 0) {
+            if (errno != EINTR) {
+                spdlog::error("INotify: epoll_wait failed on the reader thread: {}", strerror(errno));
+                return;
+            }
+            continue;
+        }
+        if (!queueEvents()) {
+            return;
+        }
+    }
+}
+
+bool INotify::queueEvents()
+{
+    constexpr std::size_t eventSize = sizeof(inotify_event);
+
+    while (true) {
+        const auto length = read(inotifyWrapper.getFd(), buffer.get(), bufferSize);
+        if (length < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                spdlog::warn("INotify: read() failed: {}", strerror(errno));
+            }
+            return true; // Drained
+        }
+
+        std::size_t i = 0;
+        while (i < static_cast<std::size_t>(length)) {
+            const auto pEvent = reinterpret_cast<const inotify_event*>(buffer.get() + i);
+            INotifyRecord record{.wd = pEvent->wd, .mask = pEvent->mask, .cookie = pEvent->cookie};
+            // The kernel pads the name with nulls
+            record.len = static_cast<std::uint32_t>(strnlen(pEvent->name, pEvent->len));
+            std::copy_n(pEvent->name, record.len, record.name.data());
+            if (!ring.tryPush(record)) {
+                // Full, so hand over what's there before waiting for room, otherwise nobody would pop any of it
+                readyFd.notify();
+                if (!ring.push(record, stopping)) {
+                    return false;
+                }
+            }
+            i += eventSize + pEvent->len;
+        }
+
+        // Per read rather than per event, so a burst is one wake up
+        readyFd.notify();
+    }
+}
+
+void INotify::processEvents()
+{
+    INotifyRecord record;
+    while (ring.tryPop(record)) {
+        if (record.mask & IN_Q_OVERFLOW) {
+            // Not for any watch, wd is -1
+            spdlog::warn("INotify: event queue overflowed, events have been lost");
+            if (overflowCallback) {
+                overflowCallback();
+            }
+        } else if (const auto index = registry.find(record.wd); index != WatchRegistry::none) {
+            if (dispatcher) {
+                dispatcher(record, INotifyWatch(registry, index));
             }
         } else {
-            spdlog::warn("INotify: read() failed: {}", strerror(errno));
+            spdlog::warn("INotify: unknown wd = {}", record.wd);
         }
-        i += eventSize + pEvent->len;
     }
 }
 
-} // namespace btl
\ No newline at end of file
+} // namespace btl
@@ -23,42 +23,97 @@
 #pragma once
 
 #include "Epoll.hpp"
+#include "EventFd.hpp"
+#include "EventSource.hpp"
 #include "INotifyWatch.hpp"
 #include "INotifyWrapper.hpp"
+#include "PendingMoves.hpp"
+#include "SpscRing.hpp"
+#include "WatchRegistry.hpp"
+#include <atomic>
+#include <chrono>
 #include <filesystem>
+#include <functional>
 #include <memory>
+#include <optional>
 #include <sys/inotify.h>
+#include <thread>
 #include <vector>
 
 namespace btl {
+
+/// Watches directories with inotify.
+///
+/// A reader thread does nothing but drain the inotify fd, copying events into a ring, so the kernel's queue is emptied
+/// however long whoever calls `watchOnce` takes over each event.  Everything else, the watches and the callbacks,
+/// happens on the thread calling `watchOnce`.
 class INotify
 {
 public:
-    INotify();
+    /// Pass to `watchOnce` to block until there is an event, or `wake` is called.
+    static constexpr std::chrono::milliseconds infinite{-1};
+
+    /// Default size of the buffer we read events into.
+    static constexpr std::size_t defaultBufferSize{64 * 1024};
+
+    /// How long a directory that was moved away waits for the matching `moveTo`, before we decide it left the tree.
+    /// The kernel queues both halves of a rename together, so this only needs to cover us reading them.
+    static constexpr std::chrono::milliseconds moveTimeout{100};
+
+    /// Events queued between the reader thread and `watchOnce`, on top of what the kernel queues.  About 1MB.
+    static constexpr std::size_t ringCapacity{4096};
+
+    /// Starts the reader thread
+    /// @param bufferSize size (bytes) of the buffer we drain events into, at least big enough for one event
+    /// @param maxWatches most watches `addWatches` will add, zero for as many as the system allows
+    explicit INotify(std::size_t bufferSize = defaultBufferSize, std::size_t maxWatches = 0);
 
-    /// Repeatedly call this to watch all folders, non blocking
-    void watchOnce();
+    /// Stops the reader thread
+    ~INotify();
+
+    INotify(const INotify&) = delete;
+    INotify& operator=(const INotify&) = delete;
+
+    /// Repeatedly call this to watch all folders, the callbacks are called from here.  Also drops directories that
+    /// were moved away and never arrived.
+    /// @param timeout how long to block waiting for events, zero (the default) returns straight away and
+    ///                `infinite` blocks until an event arrives, `wake` is called, or a move expires.
+    void watchOnce(std::chrono::milliseconds timeout = std::chrono::milliseconds::zero());
+
+    /// Wake a thread blocked in `watchOnce`.  Safe to call from any thread.
+    void wake() const;
+
+    /// Called with every event, for whichever watch.  One callback for all of them, rather than one per watch.
+    /// @param callback
+    void onEvent(INotifyCallback callback) { dispatcher = std::move(callback); }
 
     /// Add a watch for the given directory
     /// @param directory
-    /// @param callback
-    void addWatch(std::filesystem::path const& directory, const INotifyCallback& callback);
+    /// @return false if the directory was already watched
+    bool addWatch(std::filesystem::path const& directory);
 
     /// Add a watch for the given directory
     /// @param directory
     /// @param flags inotify flags
-    /// @param callback
-    void addWatch(std::filesystem::path const& directory, int flags, const INotifyCallback& callback);
+    /// @return false if the directory was already watched
+    bool addWatch(std::filesystem::path const& directory, int flags);
+
+    /// Add a watch for each of the given directories, e.g. the result of a scan.  Doesn't throw if we can't watch some
+    /// of them, which happens when we run out of watches in big trees (or hit `maxWatches`), they're reported back
+    /// instead.
+    /// @param directories
+    /// @return how many watches we got, and which directories we didn't
+    WatchReport addWatches(std::vector<std::filesystem::path> const& directories);
 
-    /// Remove the given watch
-    /// @param watch
-    void remove(const INotifyWatch& watch);
+    /// The system wide limit on watches per user, i.e. `fs.inotify.max_user_watches`
+    /// @return the limit, empty if we couldn't read it
+    [[nodiscard]] static std::optional<std::size_t> maxUserWatches();
 
-    /// Remove the watch on the given directory
+    /// Remove the watch on the given directory, and the watches beneath it
     /// @param directory
     void remove(const std::filesystem::path& directory);
 
-    /// Set the directory for the given cookie, if cookie is set.
+    /// A directory arrived.  If it was moved from within the tree its watches (and those beneath) move with it.
     ///
     ///     in.moveFrom("a/b/c", 1234);
     ///     in.moveTo("d/e/f", 1234);
@@ -67,24 +122,74 @@ public:
     ///
     ///     mv a/b/c d/e/f
     ///
-    void moveTo(std::filesystem::path const& directory, std::uint32_t cookie);
+    /// @return false if we don't know where it came from, e.g. outside the tree, so it needs watching
+    bool moveTo(std::filesystem::path const& directory, std::uint32_t cookie);
 
-    /// Set the cookie on the given directory, if exists.
-    ///
-    ///     in.moveFrom("a/b/c", 1234);
-    ///     in.moveTo("d/e/f", 1234);
-    ///
-    /// equals
-    ///
-    ///     mv a/b/c d/e/f
-    ///
+    /// A watched directory was moved away.  It waits `moveTimeout` for the matching `moveTo`, after that we assume it
+    /// left the tree and drop its watches.
     void moveFrom(std::filesystem::path const& directory, std::uint32_t cookie);
 
+    /// Number of directories currently being watched.
+    [[nodiscard]] std::size_t watchCount() const;
+
+    /// Called when the kernel's event queue overflows (`IN_Q_OVERFLOW`) and events have been lost.
+    /// @param callback
+    void onOverflow(std::function<void()> callback) { overflowCallback = std::move(callback); }
+
 private:
-    void processEvent();
+    /// The reader thread: wait for events, and queue them, until we're stopping
+    void readEvents();
+
+    /// Read events until the inotify fd would block, queueing them for `processEvents`.  On the reader thread.
+    /// @return false if we're stopping
+    bool queueEvents();
 
+    /// Dispatch the queued events
+    void processEvents();
+
+    /// Remove the watch and everything beneath it, from us and the kernel
+    void removeSubtree(std::uint32_t index);
+
+    /// Drop the directories that were moved away, and never arrived
+    void expireMoves();
+
+    /// Closing it drops all the kernel's watches, so the registry doesn't need to.
     INotifyWrapper inotifyWrapper{};
-    std::vector<std::unique_ptr<INotifyWatch>> watches{};
+
+    /// What each watch is on
+    WatchRegistry registry{};
+
+    /// Every event goes through here
+    INotifyCallback dispatcher{};
+
+    /// wds of the directories moved away, keyed on cookie
+    PendingMoves<int> moves{moveTimeout};
+
+    /// Reused for every `read` (on the reader thread), so we're not allocating per batch of events.
+    std::size_t bufferSize{};
+    std::unique_ptr<char[]> buffer{};
+
+    /// Zero for no limit of our own
+    std::size_t maxWatches{};
+
+    std::function<void()> overflowCallback{};
+
+    EventFd wakeFd{};
+
+    /// For `watchOnce`, on `readyFd` and `wakeFd`
     Epoll epoll{};
+
+    /// From the reader thread to `watchOnce`
+    SpscRing<INotifyRecord> ring{ringCapacity};
+
+    /// Written by the reader thread when there's something in `ring`
+    EventFd readyFd{};
+
+    /// Tells the reader thread to finish
+    EventFd stopFd{};
+    std::atomic<bool> stopping{};
+
+    /// Last, so everything it uses is there while it runs
+    std::jthread reader{};
 };
 } // namespace btl
\ No newline at end of file
@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "INotifyEventSource.hpp"
+#include "INotifyEvent.hpp"
+#include <array>
+#include <spdlog/spdlog.h>
+#include <string>
+#include <utility>
+
+namespace btl {
+
+INotifyEventSource::INotifyEventSource(const Config& config, FileEventCallback callback)
+    : callback(std::move(callback))
+    , inotify(config.readBufferSize, config.maxWatches)
+{
+    inotify.onEvent([this](const INotifyRecord& event, const INotifyWatch& watch) { onEvent(event, watch); });
+    inotify.onOverflow([this] { this->callback({.type = FileEvent::Type::Overflow}); });
+}
+
+WatchReport INotifyEventSource::addDirectories(const std::vector<std::filesystem::path>& directories)
+{
+    auto report = inotify.addWatches(directories);
+    if (!report.failed.empty()) {
+        const auto limit = INotify::maxUserWatches();
+        spdlog::warn(
+            "Watching {} of {} directories, fs.inotify.max_user_watches is {}",
+            report.obtained,
+            report.requested,
+            limit ? std::to_string(*limit) : "unknown");
+    }
+    return report;
+}
+
+void INotifyEventSource::removeDirectory(const std::filesystem::path& directory)
+{
+    inotify.remove(directory);
+}
+
+void INotifyEventSource::movedFrom(const std::filesystem::path& directory, const std::uint32_t cookie)
+{
+    inotify.moveFrom(directory, cookie);
+}
+
+bool INotifyEventSource::movedTo(const std::filesystem::path& directory, const std::uint32_t cookie)
+{
+    return inotify.moveTo(directory, cookie);
+}
+
+void INotifyEventSource::watchOnce(const std::chrono::milliseconds timeout)
+{
+    inotify.watchOnce(timeout);
+}
+
+void INotifyEventSource::wake() const
+{
+    inotify.wake();
+}
+
+void INotifyEventSource::onEvent(const INotifyRecord& event, const INotifyWatch& watch) const
+{
+    if (!event.len) {
+        return;
+    }
+
+    /// These must match what we asked for in inotify
+    spdlog::trace(
+        "Cookie={}  Event={}  Path={}",
+        event.cookie,
+        to_string(INotifyEvent{event.mask}),
+        (watch.getDirectory() / event.getName()).string());
+
+    using enum FileEvent::Type;
+    constexpr std::array types = {
+        std::pair{IN_CREATE, Created},
+        std::pair{IN_DELETE, Deleted},
+        std::pair{IN_MODIFY, Modified},
+        std::pair{IN_MOVED_FROM, MovedFrom},
+        std::pair{IN_MOVED_TO, MovedTo},
+    };
+
+    for (const auto& [mask, type] : types) {
+        if (event.mask & mask) {
+            callback({
+                .type = type,
+                .isDirectory = (event.mask & IN_ISDIR) != 0,
+                .directory = watch.getDirectory(),
+                .name = std::string(event.getName()),
+                .cookie = event.cookie,
+            });
+        }
+    }
+}
+
+} // namespace btl
@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "EventSource.hpp"
+#include "INotify.hpp"
+
+namespace btl {
+
+/// Events from inotify, which needs a watch on every directory.
+class INotifyEventSource : public EventSource
+{
+public:
+    /// @param config for the read buffer size and watch limit
+    /// @param callback called with each event
+    INotifyEventSource(const Config& config, FileEventCallback callback);
+
+    WatchReport addDirectories(const std::vector<std::filesystem::path>& directories) override;
+    void removeDirectory(const std::filesystem::path& directory) override;
+    void movedFrom(const std::filesystem::path& directory, std::uint32_t cookie) override;
+    bool movedTo(const std::filesystem::path& directory, std::uint32_t cookie) override;
+    void watchOnce(std::chrono::milliseconds timeout) override;
+    void wake() const override;
+
+private:
+    /// Turn the inotify event into ours, and pass it on.
+    void onEvent(const INotifyRecord& event, const INotifyWatch& watch) const;
+
+    FileEventCallback callback{};
+
+    INotify inotify;
+};
+
+} // namespace btl
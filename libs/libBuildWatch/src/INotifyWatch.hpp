@@ -22,69 +22,53 @@
 
 #pragma once
 
-#include "MoveOnly.hpp"
+#include "WatchRegistry.hpp"
+#include <array>
+#include <climits>
+#include <cstdint>
 #include <filesystem>
-#include <fmt/std.h>
-#include <spdlog/spdlog.h>
+#include <functional>
+#include <string_view>
 #include <sys/inotify.h>
 
 namespace btl {
-class INotifyWatch;
-using INotifyCallback = std::function<void(const inotify_event&, const INotifyWatch&)>;
 
-class INotifyWatch
+/// An `inotify_event`, copied out of the kernel's variable length format so it can be queued between threads.
+struct INotifyRecord
 {
-public:
-    INotifyWatch(int fd, std::filesystem::path const& directory, const int flags, INotifyCallback callback)
-        : fd(fd)
-        , directory(directory)
-        , callback(std::move(callback))
-    {
-        if (!std::filesystem::is_directory(directory)) {
-            throw std::runtime_error(fmt::format("Path is not a directory: {}", directory));
-        }
-
-        wd = inotify_add_watch(fd, directory.c_str(), flags);
+    int wd{};
+    std::uint32_t mask{};
+    std::uint32_t cookie{};
 
-        if (wd == -1) {
-            throw std::system_error(errno, std::system_category());
-        }
+    /// Length of `name`, zero if the event is about the watched directory itself
+    std::uint32_t len{};
+    std::array<char, NAME_MAX + 1> name{};
 
-        spdlog::trace("INotifyWatch::INotifyWatch Added inotify watch fd={} wd={} dir={}", fd, wd.get(), directory);
-    }
+    [[nodiscard]] std::string_view getName() const { return {name.data(), len}; }
+};
 
-    ~INotifyWatch()
-    {
-        remove();
-        spdlog::trace(
-            "INotifyWatch::~INotifyWatch Removed inotify watch fd={} wd={} dir={}", fd.get(), wd.get(), directory);
-    }
+class INotifyWatch;
+using INotifyCallback = std::function<void(const INotifyRecord&, const INotifyWatch&)>;
 
-    void remove()
+/// The watch an event is for, as handed to the callback.  Just a reference into the registry, only valid during the
+/// callback.
+class INotifyWatch
+{
+public:
+    INotifyWatch(const WatchRegistry& registry, const std::uint32_t index)
+        : registry(&registry)
+        , index(index)
     {
-        inotify_rm_watch(fd, wd);
-        directory.clear();
     }
 
-    [[nodiscard]] std::filesystem::path const& getDirectory() const { return directory; }
-
-    void onEvent(const inotify_event& event) const { return callback(event, *this); }
+    /// Full path of the directory, built from the names of the watches above
+    [[nodiscard]] std::filesystem::path getDirectory() const { return registry->directory(index); }
 
-    [[nodiscard]] bool operator==(const int wd) const { return wd == this->wd.get(); }
-
-    [[nodiscard]] bool operator==(const INotifyWatch& other) const
-    {
-        return other.wd == wd && other.directory == directory && other.fd == fd;
-    }
-
-    friend class INotify;
+    [[nodiscard]] int getWd() const { return registry->wd(index); }
 
 private:
-    MoveOnly<int, -1> fd{};
-    MoveOnly<int, -1> wd{};
-    std::uint32_t cookie{};
-    std::filesystem::path directory{};
-    INotifyCallback callback{};
+    const WatchRegistry* registry{};
+    std::uint32_t index{};
 };
 
-} // namespace btl
\ No newline at end of file
+} // namespace btl
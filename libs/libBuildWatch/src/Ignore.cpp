@@ -21,13 +21,16 @@
  */
 
 #include "Ignore.hpp"
+#include "FileUtils.hpp"
 
 #include "spdlog/spdlog.h"
 #include <algorithm>
+#include <array>
 #include <cassert>
 #include <fmt/std.h>
+#include <fstream>
 #include <ranges>
-#include <regex>
+#include <span>
 #include <utility>
 
 namespace rg = std::ranges;
@@ -46,30 +49,84 @@ void trim(std::string& s)
     s.erase(s.begin(), rg::find_if(s, nonSpace));
 }
 
-std::string escapeStringForRegex(const std::string& s)
+constexpr std::string_view anySegments = "**";
+
+/// Split on `/`, dropping empty segments
+template<typename T>
+std::vector<T> split(std::string_view path)
 {
-    static constexpr char metacharacters[] = R"(\.^$+()[]{}|?*)";
-    std::string out;
-    out.reserve(s.size());
-    for (const auto ch : s) {
-        if (std::strchr(metacharacters, ch)) {
-            out.push_back('\\');
+    std::vector<T> segments;
+    for (const auto segment : vw::split(path, '/')) {
+        if (!segment.empty()) {
+            segments.emplace_back(segment.begin(), segment.end());
         }
-        out.push_back(ch);
     }
-    return out;
+    return segments;
+}
+
+/// Glob match a single path segment, supporting `*`, `?` and `\` escapes.
+bool matchSegment(const std::string_view glob, const std::string_view name)
+{
+    std::size_t g = 0;
+    std::size_t n = 0;
+    // Where to resume if we need to backtrack to the last `*`
+    std::size_t starGlob = std::string_view::npos;
+    std::size_t starName = 0;
+
+    while (n < name.size()) {
+        if (g < glob.size() && glob[g] == '*') {
+            starGlob = g++;
+            starName = n;
+        } else if (g < glob.size() && glob[g] == '?') {
+            ++g;
+            ++n;
+        } else if (g < glob.size() && glob[g] == '\\' && g + 1 < glob.size() && glob[g + 1] == name[n]) {
+            g += 2;
+            ++n;
+        } else if (g < glob.size() && glob[g] != '\\' && glob[g] == name[n]) {
+            ++g;
+            ++n;
+        } else if (starGlob != std::string_view::npos) {
+            // Let the last `*` swallow one more character
+            g = starGlob + 1;
+            n = ++starName;
+        } else {
+            return false;
+        }
+    }
+
+    while (g < glob.size() && glob[g] == '*') {
+        ++g;
+    }
+    return g == glob.size();
+}
+
+/// Does the pattern match the start of the path, i.e. the path itself or one of its parent directories?
+bool matchPrefix(std::span<const std::string> pattern, std::span<const std::string_view> path, const bool matchedAny)
+{
+    if (pattern.empty()) {
+        return matchedAny;
+    }
+    if (pattern.front() == anySegments) {
+        return matchPrefix(pattern.subspan(1), path, matchedAny)
+            || (!path.empty() && matchPrefix(pattern, path.subspan(1), true));
+    }
+    if (path.empty()) {
+        return false;
+    }
+    return matchSegment(pattern.front(), path.front()) && matchPrefix(pattern.subspan(1), path.subspan(1), true);
 }
 } // namespace
 
 namespace btl {
 
 Ignore::Ignore(std::filesystem::path repoRoot, std::filesystem::path const& path)
-    : patterns(toRegex(read(path)))
+    : patterns(compile(read(path)))
     , repoRoot(std::move(repoRoot))
 {}
 
 Ignore::Ignore(std::filesystem::path repoRoot, std::vector<std::string> const& lines)
-    : patterns(toRegex(lines))
+    : patterns(compile(lines))
     , repoRoot(std::move(repoRoot))
 {}
 
@@ -93,42 +150,27 @@ std::vector<std::string> Ignore::read(std::filesystem::path const& path)
     return lines;
 }
 
-std::string Ignore::toRegex(std::string const& pattern)
+Ignore::IgnorePattern Ignore::compile(std::string const& pattern, const bool isNegative)
 {
-    std::string regexPattern;
-    size_t i = 0;
-    while (i < pattern.size()) {
-        if (pattern[i] == '*') {
-            if (i + 1 < pattern.size() && pattern[i + 1] == '*') {
-                // Handle '**' (matches zero or more directories)
-                regexPattern += ".*";
-                i++;
-            } else {
-                // Handle single '*'
-                regexPattern += "[^/]*";
-            }
-        } else if (pattern[i] == '?') {
-            regexPattern += ".";
-        } else if (pattern[i] == '/') {
-            regexPattern += "/"; // Keep directory separators as-is
-        } else if (pattern[i] == '.') {
-            regexPattern += "\\.";
-        } else {
-            regexPattern += escapeStringForRegex(std::string(1, pattern[i]));
-        }
-        i++;
+    // As per gitignore, a leading or middle `/` anchors the pattern to the root, otherwise (e.g. `build/`) it matches
+    // at any depth.
+    std::string_view view = pattern;
+    if (view.ends_with('/')) {
+        view.remove_suffix(1);
     }
+    const bool anchored = view.contains('/');
 
-    // Ensure directory-specific patterns ending with '/' match subpaths
-    if (!pattern.empty() && pattern.back() == '/') {
-        regexPattern += ".*";
+    IgnorePattern result{isNegative, {}};
+    if (!anchored) {
+        result.segments.emplace_back(anySegments);
     }
-    return regexPattern;
+    rg::move(split<std::string>(view), std::back_inserter(result.segments));
+    return result;
 }
 
-std::vector<Ignore::IgnoreRegex> Ignore::toRegex(std::vector<std::string> const& lines)
+std::vector<Ignore::IgnorePattern> Ignore::compile(std::vector<std::string> const& lines)
 {
-    std::vector<IgnoreRegex> result;
+    std::vector<IgnorePattern> result;
     for (auto line : lines) {
         trim(line);
         if (line.empty() || line.at(0) == '#') {
@@ -143,37 +185,48 @@ std::vector<Ignore::IgnoreRegex> Ignore::toRegex(std::vector<std::string> const&
             isNegative = true;
             line = line.substr(1);
         }
-        result.push_back({isNegative, toRegex(line)});
+        result.push_back(compile(line, isNegative));
     }
 
     // And add .git and .hg directories.
 
-    result.push_back({false, toRegex(".git/")});
-    result.push_back({false, toRegex(".hg/")});
+    result.push_back(compile("/.git/", false));
+    result.push_back(compile("/.hg/", false));
     return result;
 }
 
 bool Ignore::ignore(std::filesystem::path const& path) const
 {
-    using namespace std::literals;
-
     assert(path.is_absolute() && "paths passed in here should be absolute");
     assert(!repoRoot.empty() && "repo root should not be empty - are you using a default constructed instance?");
 
-    // gitignore matches paths relative to root.
-    const auto relpath = fs::relative(path, repoRoot);
+    // gitignore matches paths relative to root.  Work that out from the strings, no filesystem calls.
+    const std::string_view absolute = path.native();
+    std::string_view root = repoRoot.native();
+    if (root.ends_with('/')) {
+        root.remove_suffix(1);
+    }
+    if (!absolute.starts_with(root) || (absolute.size() > root.size() && absolute[root.size()] != '/')) {
+        return false;
+    }
+
+    const auto relpath = absolute.substr(root.size());
     spdlog::trace("Ignore::ignore relative path calculated as: {}", relpath);
+    return ignoreRelative(relpath);
+}
+
+bool Ignore::ignoreRelative(const std::string_view relpath) const
+{
+    const auto segments = split<std::string_view>(relpath);
+    if (segments.empty()) {
+        return false;
+    }
 
     bool isIgnored = false;
 
-    // Walk through regexes in line order, to figure out if we should ignore this path.
+    // Walk through patterns in line order, to figure out if we should ignore this path.
     for (const auto& pattern : patterns) {
-        // Yes, std::regex :(
-        std::regex regexPattern(pattern.regex);
-
-        // Also test with a trailing `/` for a directory match.  Not using `is_directory` because that
-        // seems to use filesystem calls.
-        if (std::regex_match(relpath.string(), regexPattern) || std::regex_match(relpath.string() + "/", regexPattern)) {
+        if (matchPrefix(pattern.segments, segments, false)) {
             isIgnored = !pattern.isNegative; // Overwrite based on match type
         }
     }
@@ -181,4 +234,45 @@ bool Ignore::ignore(std::filesystem::path const& path) const
     return isIgnored;
 }
 
-}
\ No newline at end of file
+std::optional<std::filesystem::path> findIgnoreFile(const std::vector<std::string>& ignoreFiles)
+{
+    for (const auto& ignoreFile : ignoreFiles) {
+        if (auto path = findUp(fs::current_path(), fs::path(ignoreFile))) {
+            return path;
+        }
+    }
+    return std::nullopt;
+}
+
+bool isIgnoredDirectory(
+    const Ignore& ignore, const std::filesystem::path& rootPath, const std::filesystem::path& directory)
+{
+    using namespace std::literals;
+
+    constexpr std::array ignores = {".git"sv, ".hg"sv};
+
+    const auto relpath = directory.lexically_relative(rootPath);
+    if (relpath.begin() != relpath.end() && rg::contains(ignores, relpath.begin()->string())) {
+        return true;
+    }
+
+    if (ignore.ignore(directory)) {
+        spdlog::trace("Ignoring directory due to .*ignore file: {}", directory);
+        return true;
+    }
+    return false;
+}
+
+IgnoreRules loadIgnoreRules(const std::filesystem::path& rootPath, const std::vector<std::string>& ignoreFiles)
+{
+    if (auto path = findIgnoreFile(ignoreFiles)) {
+        spdlog::info("Using .*ignore file: {}", *path);
+        return {.ignore = Ignore(path->parent_path(), *path), .path = std::move(*path)};
+    }
+
+    spdlog::warn("No .*ignore file found, we're watching all directories");
+    // Still skip .git and friends
+    return {.ignore = Ignore(rootPath, std::vector<std::string>{})};
+}
+
+}
@@ -22,13 +22,18 @@
 
 #pragma once
 #include <filesystem>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace btl {
 
 /// Take a gitignore file, read it, and then store it and apply to filesystem path and return true/false
 /// Really rough v1.  Doesn't care about nested gitignores.
+///
+/// Patterns are compiled once, on construction, into path segments, and matched against the path relative to the
+/// repo root without touching the filesystem.
 class Ignore
 {
 public:
@@ -37,23 +42,55 @@ public:
     Ignore(std::filesystem::path  repoRoot, std::vector<std::string> const& lines);
 
     /// Returns true if we should ignore this path
+    /// @param path absolute path, paths outside the repo root are never ignored
     [[nodiscard]] bool ignore(std::filesystem::path const& path) const;
 
+    /// Returns true if we should ignore this path
+    /// @param relpath path relative to the repo root, separated by `/`
+    [[nodiscard]] bool ignoreRelative(std::string_view relpath) const;
+
 private:
-    struct IgnoreRegex
+    struct IgnorePattern
     {
         bool isNegative{};
-        std::string regex;
+        /// Pattern segments, split on `/`.  `**` matches zero or more segments.  Unanchored patterns start with `**`.
+        std::vector<std::string> segments;
     };
 
-    std::vector<IgnoreRegex> patterns{};
+    std::vector<IgnorePattern> patterns{};
     std::filesystem::path repoRoot{};
 
     [[nodiscard]] static std::vector<std::string> read(std::filesystem::path const& path) ;
-    [[nodiscard]] static std::string toRegex(std::string const& pattern);
-    [[nodiscard]] static std::vector<IgnoreRegex> toRegex(std::vector<std::string> const& lines);
+    [[nodiscard]] static IgnorePattern compile(std::string const& pattern, bool isNegative);
+    [[nodiscard]] static std::vector<IgnorePattern> compile(std::vector<std::string> const& lines);
 };
 
+/// Look for the first of `ignoreFiles` at or above the current directory
+/// @param ignoreFiles names to look for, in order, e.g. `.gitignore`
+/// @return the path to the ignore file, empty if there isn't one
+[[nodiscard]] std::optional<std::filesystem::path> findIgnoreFile(const std::vector<std::string>& ignoreFiles);
+
+/// Should we skip this directory, and everything beneath it?  Version control directories always are.  Thread safe.
+/// @param ignore the ignore rules
+/// @param rootPath the root of the tree we're looking at
+/// @param directory absolute path to the directory
+[[nodiscard]] bool isIgnoredDirectory(
+    const Ignore& ignore, const std::filesystem::path& rootPath, const std::filesystem::path& directory);
+
+/// The ignore rules for a tree, and where they came from
+struct IgnoreRules
+{
+    Ignore ignore{};
+
+    /// The ignore file, empty if there isn't one
+    std::filesystem::path path{};
+};
 
+/// Load the rules for the tree, from the first of `ignoreFiles` we find, otherwise just the defaults.  Used by both
+/// the watcher and `regenerateAll`, so they skip the same directories.
+/// @param rootPath the root of the tree we're looking at
+/// @param ignoreFiles names to look for, in order, e.g. `.gitignore`
+[[nodiscard]] IgnoreRules loadIgnoreRules(
+    const std::filesystem::path& rootPath, const std::vector<std::string>& ignoreFiles);
 
 }
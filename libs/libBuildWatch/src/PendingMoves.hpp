@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <vector>
+
+namespace btl {
+
+/// Things that have been moved away, waiting to hear where they went.
+///
+/// A rename is reported as a "moved from" and then a "moved to" with the same cookie.  When the "moved to" never comes
+/// the thing went somewhere we can't see, so entries expire after `timeout`.  Only ever holds a handful of entries.
+template<typename Value>
+class PendingMoves
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    PendingMoves() = default;
+
+    explicit PendingMoves(const std::chrono::milliseconds timeout)
+        : timeout(timeout)
+    {}
+
+    /// Something was moved away
+    void add(const std::uint32_t cookie, const Value& value, const Clock::time_point now = Clock::now())
+    {
+        pending.insert_or_assign(cookie, Entry{.value = value, .expires = now + timeout});
+    }
+
+    /// Pair up a "moved to" with its "moved from"
+    /// @return what was moved away with the cookie, empty if nothing was (or it expired)
+    [[nodiscard]] std::optional<Value> take(const std::uint32_t cookie)
+    {
+        const auto iter = pending.find(cookie);
+        if (iter == pending.end()) {
+            return std::nullopt;
+        }
+        auto value = std::move(iter->second.value);
+        pending.erase(iter);
+        return value;
+    }
+
+    /// @return the entries that have expired, removed from the table
+    [[nodiscard]] std::vector<Value> expire(const Clock::time_point now = Clock::now())
+    {
+        std::vector<Value> expired;
+        for (auto iter = pending.begin(); iter != pending.end();) {
+            if (iter->second.expires <= now) {
+                expired.push_back(std::move(iter->second.value));
+                iter = pending.erase(iter);
+            } else {
+                ++iter;
+            }
+        }
+        return expired;
+    }
+
+    /// @return how long until the next entry expires, or empty if there's nothing pending
+    [[nodiscard]] std::optional<std::chrono::milliseconds> timeUntilExpiry(
+        const Clock::time_point now = Clock::now()) const
+    {
+        if (pending.empty()) {
+            return std::nullopt;
+        }
+        auto earliest = Clock::time_point::max();
+        for (const auto& [cookie, entry] : pending) {
+            earliest = std::min(earliest, entry.expires);
+        }
+        if (earliest <= now) {
+            return std::chrono::milliseconds::zero();
+        }
+        // Round up, otherwise we wake up a fraction too early and go straight back to sleep
+        return std::chrono::ceil<std::chrono::milliseconds>(earliest - now);
+    }
+
+    /// @return true if nothing is waiting
+    [[nodiscard]] bool empty() const { return pending.empty(); }
+
+private:
+    struct Entry
+    {
+        Value value{};
+        Clock::time_point expires{};
+    };
+
+    std::chrono::milliseconds timeout{100};
+
+    /// Keyed on cookie
+    std::map<std::uint32_t, Entry> pending{};
+};
+
+} // namespace btl
@@ -0,0 +1,191 @@
+/*
+ * Copyright (c) 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <BuildWatch/Regenerate.hpp>
+#include "Diff.hpp"
+#include "FileIndex.hpp"
+#include "FileUtils.hpp"
+#include "Ignore.hpp"
+#include "RenderPool.hpp"
+#include "Scanner.hpp"
+#include "Template.hpp"
+#include <algorithm>
+#include <functional>
+#include <fmt/std.h>
+#include <spdlog/spdlog.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+enum class Outcome
+{
+    Unchanged,
+    Changed,
+    Failed,
+};
+
+/// One template to render
+struct Job
+{
+    const btl::TemplateFile* templateFile{};
+    fs::path templatePath{};
+    fs::path destPath{};
+    Outcome outcome{};
+
+    /// Only for checks
+    btl::Diff diff{};
+};
+
+/// Called from the worker threads with each rendered template, sets the outcome.  May throw.
+using OnRendered = std::function<void(Job& job, const std::string& output)>;
+
+/// Scan the tree once, then render every template found on a pool of threads, passing each output to `onRendered`
+std::vector<Job> renderAll(
+    const fs::path& root, const btl::Config& config, std::size_t threadCount, const OnRendered& onRendered)
+{
+    using namespace btl;
+
+    const auto rootPath = root.empty() ? fs::current_path() : root;
+    if (threadCount == 0) {
+        threadCount = defaultThreadCount();
+    }
+
+    // Same rules as BuildWatch
+    const auto ignore = loadIgnoreRules(rootPath, config.ignoreFiles).ignore;
+    const auto skip = [&](const fs::path& directory) { return isIgnoredDirectory(ignore, rootPath, directory); };
+    const auto scan = scanTree(rootPath, skip, threadCount);
+
+    FileIndex index(config.files);
+    for (const auto& file : scan.files) {
+        index.add(file);
+    }
+
+    std::vector<Job> jobs;
+    for (const auto& templateFile : config.files) {
+        for (auto& templatePath : index.templatePaths(templateFile)) {
+            auto destPath = templatePath.parent_path() / templateFile.dest;
+            jobs.push_back({
+                .templateFile = &templateFile,
+                .templatePath = std::move(templatePath),
+                .destPath = std::move(destPath),
+            });
+        }
+    }
+    spdlog::info("Rendering {} templates found in {} directories", jobs.size(), scan.directories.size());
+
+    // Each job only reads the (now const) index and its own entry.  Keyed on where they write, as the watcher does,
+    // so two templates writing the same file never run at once.
+    RenderPool pool(threadCount);
+    for (auto& job : jobs) {
+        pool.submit(job.destPath.string(), [&index, &onRendered, &job] {
+            try {
+                const auto output
+                    = Template(readFile(job.templatePath)).render(index.files(*job.templateFile, job.templatePath));
+                onRendered(job, output);
+            } catch (const std::exception& ex) {
+                spdlog::error("Could not generate {} from {}: {}", job.destPath, job.templatePath, ex.what());
+                job.outcome = Outcome::Failed;
+            }
+        });
+    }
+    pool.wait();
+
+    std::ranges::sort(jobs, {}, &Job::destPath);
+    return jobs;
+}
+
+} // namespace
+
+namespace btl {
+
+RegenerateReport regenerateAll(
+    const std::filesystem::path& root, const Config& config, const bool dryRun, const std::size_t threadCount)
+{
+    const auto jobs = renderAll(root, config, threadCount, [dryRun](Job& job, const std::string& output) {
+        const bool changed = dryRun ? !hasContent(job.destPath, output) : writeIfChanged(job.destPath, output);
+        if (changed) {
+            spdlog::info("{} {}", dryRun ? "Out of date" : "Writing", job.destPath.string());
+        }
+        job.outcome = changed ? Outcome::Changed : Outcome::Unchanged;
+    });
+
+    RegenerateReport report{.templates = jobs.size()};
+    for (const auto& job : jobs) {
+        if (job.outcome == Outcome::Changed) {
+            report.changed.push_back(job.destPath);
+        } else if (job.outcome == Outcome::Failed) {
+            report.failed.push_back(job.templatePath);
+        }
+    }
+    return report;
+}
+
+CheckReport checkAll(
+    const std::filesystem::path& root,
+    const Config& config,
+    const std::size_t maxDiffLines,
+    const std::size_t threadCount)
+{
+    auto jobs = renderAll(root, config, threadCount, [](Job& job, const std::string& output) {
+        if (hasContent(job.destPath, output)) {
+            job.outcome = Outcome::Unchanged;
+            return;
+        }
+
+        // Missing counts as empty
+        std::string existing;
+        if (std::error_code ec; fs::exists(job.destPath, ec)) {
+            existing = readFile(job.destPath);
+        }
+        job.diff = diffLines(existing, output, job.destPath.string(), fmt::format("{} (generated)", job.destPath));
+        job.outcome = Outcome::Changed;
+    });
+
+    CheckReport report{.templates = jobs.size()};
+    for (auto& job : jobs) {
+        if (job.outcome == Outcome::Changed) {
+            auto& diff = job.diff.text;
+
+            // Keep the output readable when everything is out of date
+            std::size_t lines = 0;
+            std::size_t position = 0;
+            while (lines < maxDiffLines && position < diff.size()) {
+                position = std::min(diff.find('\n', position), diff.size() - 1) + 1;
+                ++lines;
+            }
+            if (position < diff.size()) {
+                const auto remaining
+                    = std::count(diff.begin() + static_cast<std::ptrdiff_t>(position), diff.end(), '\n');
+                diff.resize(position);
+                diff += fmt::format("... {} more lines\n", remaining);
+            }
+
+            report.mismatches.push_back({job.destPath, std::move(diff), job.diff.added, job.diff.removed});
+        } else if (job.outcome == Outcome::Failed) {
+            report.failed.push_back(job.templatePath);
+        }
+    }
+    return report;
+}
+
+} // namespace btl
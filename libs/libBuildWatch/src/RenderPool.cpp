@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "RenderPool.hpp"
+#include "Threads.hpp"
+#include <algorithm>
+#include <spdlog/spdlog.h>
+
+namespace btl {
+
+RenderPool::RenderPool(const std::size_t maxThreads)
+    : threadLimit(maxThreads == 0 ? defaultThreadCount() : maxThreads)
+{
+}
+
+RenderPool::~RenderPool()
+{
+    {
+        std::scoped_lock lock(mutex);
+        stopping = true;
+    }
+    changed.notify_all();
+}
+
+void RenderPool::submit(const std::string& key, Job job)
+{
+    {
+        std::scoped_lock lock(mutex);
+        if (const auto queued = std::ranges::find(jobs, key, &Queued::key); queued != jobs.end()) {
+            queued->job = std::move(job);
+            return;
+        }
+
+        jobs.push_back({key, std::move(job)});
+        if (idle == 0 && workers.size() < threadLimit) {
+            workers.emplace_back([this] { run(); });
+        }
+    }
+    changed.notify_all();
+}
+
+void RenderPool::wait()
+{
+    std::unique_lock lock(mutex);
+    changed.wait(lock, [this] { return jobs.empty() && running.empty(); });
+}
+
+std::deque<RenderPool::Queued>::iterator RenderPool::nextRunnable()
+{
+    return std::ranges::find_if(jobs, [this](const Queued& queued) { return !running.contains(queued.key); });
+}
+
+void RenderPool::run()
+{
+    std::unique_lock lock(mutex);
+    while (true) {
+        ++idle;
+        changed.wait(lock, [this] { return (stopping && jobs.empty()) || nextRunnable() != jobs.end(); });
+        --idle;
+        if (jobs.empty()) {
+            return;
+        }
+
+        const auto next = nextRunnable();
+        auto [key, job] = std::move(*next);
+        jobs.erase(next);
+        running.insert(key);
+        lock.unlock();
+
+        try {
+            job();
+        } catch (const std::exception& ex) {
+            spdlog::error("Render job for {} failed: {}", key, ex.what());
+        }
+
+        lock.lock();
+        running.erase(key);
+        changed.notify_all();
+    }
+}
+
+} // namespace btl
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace btl {
+
+/// Renders templates, and writes them out, away from the thread handling events, so that never waits on the disk.
+///
+/// Jobs are keyed on what they write, i.e. the destination path.  Jobs with different keys run in parallel, up to
+/// `maxThreads` at once, jobs with the same key run one at a time, in the order they were submitted.  Workers are
+/// started as they're needed.
+class RenderPool
+{
+public:
+    using Job = std::function<void()>;
+
+    /// @param maxThreads most jobs to run at once, zero for one per core
+    explicit RenderPool(std::size_t maxThreads = 1);
+
+    /// Finishes the jobs already submitted
+    ~RenderPool();
+
+    RenderPool(const RenderPool&) = delete;
+    RenderPool& operator=(const RenderPool&) = delete;
+
+    /// Queue a job.  If a job with the same key is still queued (not running) it's replaced, the newer job makes it
+    /// redundant.  Jobs should handle their own errors.  Safe to call from any thread.
+    void submit(const std::string& key, Job job);
+
+    /// Block until every job submitted so far has finished
+    void wait();
+
+    [[nodiscard]] std::size_t maxThreads() const { return threadLimit; }
+
+private:
+    struct Queued
+    {
+        std::string key;
+        Job job;
+    };
+
+    /// The workers: run jobs until we're stopping and there are none left
+    void run();
+
+    /// The oldest job whose key isn't running, `jobs.end()` if there's none.  Hold `mutex`.
+    [[nodiscard]] std::deque<Queued>::iterator nextRunnable();
+
+    std::size_t threadLimit{};
+
+    std::mutex mutex{};
+
+    /// Jobs queued or finished, or we're stopping
+    std::condition_variable changed{};
+
+    std::deque<Queued> jobs{};
+
+    /// Keys of the jobs taken from the queue, but not finished
+    std::set<std::string> running{};
+
+    /// Workers waiting for a job
+    std::size_t idle{};
+
+    bool stopping{};
+
+    /// Last, so everything they use is there while they run
+    std::vector<std::jthread> workers{};
+};
+
+} // namespace btl
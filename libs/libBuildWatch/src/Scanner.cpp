@@ -0,0 +1,325 @@
+/*
+ * Copyright (c) 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "Scanner.hpp"
+#include "MoveOnly.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstring>
+#include <deque>
+#include <dirent.h>
+#include <fcntl.h>
+#include <fmt/std.h>
+#include <mutex>
+#include <optional>
+#include <spdlog/spdlog.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+/// RRID directory fd
+class DirectoryFd
+{
+public:
+    explicit DirectoryFd(const fs::path& path)
+        : fd(open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC))
+    {}
+
+    ~DirectoryFd()
+    {
+        if (fd.get() != -1) {
+            close(fd);
+        }
+    }
+
+    [[nodiscard]] int get() const { return fd.get(); }
+
+private:
+    btl::MoveOnly<int, -1> fd;
+};
+
+/// One queue per thread, the owner works from the back (depth first, good locality), thieves take from the front
+/// (the biggest remaining sub-trees).
+class WorkQueues
+{
+public:
+    explicit WorkQueues(const std::size_t count)
+        : queues(count)
+    {}
+
+    void push(const std::size_t worker, fs::path directory)
+    {
+        ++pending;
+        ++queued;
+        {
+            const std::scoped_lock lock(queues.at(worker).mutex);
+            queues.at(worker).directories.push_back(std::move(directory));
+        }
+        if (idle > 0) {
+            const std::scoped_lock lock(idleMutex);
+            idleCondition.notify_one();
+        }
+    }
+
+    [[nodiscard]] std::optional<fs::path> pop(const std::size_t worker)
+    {
+        {
+            auto& own = queues.at(worker);
+            const std::scoped_lock lock(own.mutex);
+            if (!own.directories.empty()) {
+                auto directory = std::move(own.directories.back());
+                own.directories.pop_back();
+                --queued;
+                return directory;
+            }
+        }
+
+        for (std::size_t i = 1; i < queues.size(); ++i) {
+            auto& victim = queues.at((worker + i) % queues.size());
+            const std::scoped_lock lock(victim.mutex);
+            if (!victim.directories.empty()) {
+                auto directory = std::move(victim.directories.front());
+                victim.directories.pop_front();
+                --queued;
+                return directory;
+            }
+        }
+        return std::nullopt;
+    }
+
+    /// Mark a directory popped from the queue as finished
+    void done()
+    {
+        if (--pending == 0) {
+            const std::scoped_lock lock(idleMutex);
+            idleCondition.notify_all();
+        }
+    }
+
+    /// All queued directories have been finished
+    [[nodiscard]] bool finished() const { return pending == 0; }
+
+    /// Block until there's something to take, or everything is finished
+    void wait()
+    {
+        std::unique_lock lock(idleMutex);
+        // Before checking, so a push either sees us waiting or we see what it pushed
+        ++idle;
+        idleCondition.wait(lock, [this] { return queued > 0 || pending == 0; });
+        --idle;
+    }
+
+private:
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<fs::path> directories;
+    };
+
+    std::vector<Queue> queues;
+
+    /// Directories queued or being processed
+    std::atomic<std::size_t> pending{};
+
+    /// Directories queued, and not yet taken.  Can briefly count one that's still being pushed.
+    std::atomic<std::ptrdiff_t> queued{};
+
+    /// Workers waiting for something to take
+    std::atomic<std::size_t> idle{};
+    std::mutex idleMutex;
+    std::condition_variable idleCondition;
+};
+
+/// Resolve the type of an entry if getdents didn't tell us, or it's a symlink
+unsigned char entryType(const int directoryFd, const char* name, unsigned char type)
+{
+    struct stat status{};
+    if (type == DT_UNKNOWN) {
+        if (fstatat(directoryFd, name, &status, AT_SYMLINK_NOFOLLOW) != 0) {
+            return DT_UNKNOWN;
+        }
+        if (S_ISREG(status.st_mode)) {
+            return DT_REG;
+        }
+        if (S_ISDIR(status.st_mode)) {
+            return DT_DIR;
+        }
+        if (!S_ISLNK(status.st_mode)) {
+            return DT_UNKNOWN;
+        }
+        type = DT_LNK;
+    }
+
+    if (type != DT_LNK) {
+        return type;
+    }
+
+    // A link to a file counts as a file, but don't follow symlinked directories, same as recursive_directory_iterator
+    if (fstatat(directoryFd, name, &status, 0) == 0 && S_ISREG(status.st_mode)) {
+        return DT_REG;
+    }
+    return DT_UNKNOWN;
+}
+
+/// What one worker found
+struct Partial
+{
+    btl::ScanResult result;
+
+    /// Directories this worker read, and when they were modified
+    std::vector<std::pair<fs::path, fs::file_time_type>> scanned;
+};
+
+void scanOne(
+    const fs::path& directory,
+    const std::size_t worker,
+    WorkQueues& queues,
+    const btl::SkipDirectory& skipDirectory,
+    Partial& partial)
+{
+    auto& result = partial.result;
+
+    const DirectoryFd directoryFd(directory);
+    if (directoryFd.get() == -1) {
+        // Deleted or unreadable since we found it
+        spdlog::debug("scanTree: could not open {}: {}", directory, strerror(errno));
+        return;
+    }
+
+    std::error_code ec;
+    if (const auto modified = fs::last_write_time(directory, ec); !ec) {
+        partial.scanned.emplace_back(directory, modified);
+    }
+
+    alignas(dirent64) std::array<char, 32 * 1024> buffer{};
+    while (true) {
+        const auto length = getdents64(directoryFd.get(), buffer.data(), buffer.size());
+        if (length <= 0) {
+            if (length < 0) {
+                spdlog::debug("scanTree: getdents64 failed for {}: {}", directory, strerror(errno));
+            }
+            return;
+        }
+
+        for (ssize_t offset = 0; offset < length;) {
+            const auto pEntry = reinterpret_cast<const dirent64*>(buffer.data() + offset);
+            offset += pEntry->d_reclen;
+
+            const std::string_view name = pEntry->d_name;
+            if (name == "." || name == "..") {
+                continue;
+            }
+
+            const auto type = entryType(directoryFd.get(), pEntry->d_name, pEntry->d_type);
+            if (type == DT_REG) {
+                result.files.emplace_back(directory / name);
+            } else if (type == DT_DIR) {
+                auto subdirectory = directory / name;
+                if (skipDirectory(subdirectory)) {
+                    spdlog::trace("scanTree: skipping {}", subdirectory);
+                    continue;
+                }
+                result.directories.push_back(subdirectory);
+                queues.push(worker, std::move(subdirectory));
+            }
+        }
+    }
+}
+
+} // namespace
+
+namespace btl {
+
+ScanResult scanTree(
+    const std::filesystem::path& root, const SkipDirectory& skipDirectory, const std::size_t threadCount)
+{
+    return scanTree(std::vector{root}, skipDirectory, threadCount);
+}
+
+ScanResult scanTree(
+    const std::vector<std::filesystem::path>& roots, const SkipDirectory& skipDirectory, const std::size_t threadCount)
+{
+    if (roots.empty()) {
+        return {};
+    }
+
+    const auto workerCount = std::max<std::size_t>(1, threadCount);
+    WorkQueues queues(workerCount);
+    std::vector<Partial> results(workerCount);
+
+    // Spread over the workers, so they don't all start by stealing from the first
+    for (std::size_t i = 0; i < roots.size(); ++i) {
+        results.front().result.directories.push_back(roots[i]);
+        queues.push(i % workerCount, roots[i]);
+    }
+
+    const auto work = [&](const std::size_t worker) {
+        while (!queues.finished()) {
+            if (const auto directory = queues.pop(worker)) {
+                scanOne(*directory, worker, queues, skipDirectory, results.at(worker));
+                queues.done();
+            } else {
+                queues.wait();
+            }
+        }
+    };
+
+    {
+        std::vector<std::jthread> threads;
+        for (std::size_t worker = 1; worker < workerCount; ++worker) {
+            threads.emplace_back(work, worker);
+        }
+        work(0);
+    }
+
+    ScanResult result;
+    std::vector<std::pair<fs::path, fs::file_time_type>> scanned;
+    for (auto& [partial, partialScanned] : results) {
+        std::ranges::move(partial.directories, std::back_inserter(result.directories));
+        std::ranges::move(partial.files, std::back_inserter(result.files));
+        std::ranges::move(partialScanned, std::back_inserter(scanned));
+    }
+    std::ranges::sort(result.directories);
+    std::ranges::sort(result.files);
+    std::ranges::sort(scanned, {}, &std::pair<fs::path, fs::file_time_type>::first);
+
+    // Both sorted, so line them up in one pass
+    result.modified.reserve(result.directories.size());
+    auto iter = scanned.begin();
+    for (const auto& directory : result.directories) {
+        if (iter != scanned.end() && iter->first == directory) {
+            result.modified.push_back(iter->second);
+            ++iter;
+        } else {
+            result.modified.push_back(fs::file_time_type::min());
+        }
+    }
+    return result;
+}
+
+} // namespace btl
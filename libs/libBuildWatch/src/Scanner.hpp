@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+#include "FileUtils.hpp"
+#include "Threads.hpp"
+#include <filesystem>
+#include <vector>
+
+namespace btl {
+
+/// What we found walking a directory tree
+struct ScanResult
+{
+    /// Directories, including the root, sorted
+    std::vector<std::filesystem::path> directories;
+
+    /// Regular files (or symlinks to them) in those directories, sorted
+    std::vector<std::filesystem::path> files;
+
+    /// Modification time of each of `directories`, taken before reading it, so anything added while we were reading
+    /// shows up as a later time.  `file_time_type::min()` if we couldn't read the directory.
+    std::vector<std::filesystem::file_time_type> modified;
+};
+
+/// Walk the tree under `root` on a pool of threads, each taking sub-directories from its own queue and stealing from
+/// the others when it runs dry, and sleeping when there's nothing to steal.  With one thread it's walked on the calling
+/// thread, which is what small, incremental scans want.  Directories are read with `getdents64`, using the entry type
+/// to avoid a `stat` per entry where the filesystem supports it.  Symlinked directories are not followed.
+/// @param root directory to walk, always included in the result
+/// @param skipDirectory return true to prune a directory, called from several threads at once
+/// @param threadCount how many threads to walk with
+[[nodiscard]] ScanResult scanTree(
+    const std::filesystem::path& root,
+    const SkipDirectory& skipDirectory,
+    std::size_t threadCount = defaultThreadCount());
+
+/// Walk several trees at once, sharing the threads between them, as `scanTree` does for one.
+/// @param roots directories to walk, always included in the result.  Shouldn't be beneath one another, unless
+///              `skipDirectory` prunes them.
+/// @param skipDirectory return true to prune a directory, called from several threads at once
+/// @param threadCount how many threads to walk with
+[[nodiscard]] ScanResult scanTree(
+    const std::vector<std::filesystem::path>& roots,
+    const SkipDirectory& skipDirectory,
+    std::size_t threadCount = defaultThreadCount());
+
+} // namespace btl
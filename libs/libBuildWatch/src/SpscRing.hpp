@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace btl {
+
+/// Bounded queue between exactly one producer thread and one consumer thread.
+///
+/// Lock free: the producer only writes `tail` and the consumer only writes `head`, each on its own cache line along
+/// with its cached copy of the other.  A full ring blocks the producer (in `push`) until the consumer makes room.
+template<typename T>
+class SpscRing
+{
+public:
+    /// @param capacity most items queued at once, rounded up to a power of two
+    explicit SpscRing(const std::size_t capacity)
+        : mask(std::bit_ceil(std::max<std::uint32_t>(static_cast<std::uint32_t>(capacity), 2)) - 1)
+        , slots(std::make_unique<T[]>(mask + 1))
+    {}
+
+    /// Producer only
+    /// @return false if it's full
+    [[nodiscard]] bool tryPush(const T& value)
+    {
+        const auto position = tail.load(std::memory_order_relaxed);
+        if (position - cachedHead > mask) {
+            cachedHead = head.load(std::memory_order_acquire);
+            if (position - cachedHead > mask) {
+                return false;
+            }
+        }
+        slots[position & mask] = value;
+        tail.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// Producer only.  Waits while it's full.  The consumer popping is what wakes us, so to stop a blocked producer
+    /// set `stop` and then pop something.
+    /// @return false if we stopped before it was pushed
+    bool push(const T& value, const std::atomic<bool>& stop)
+    {
+        while (!tryPush(value)) {
+            const auto observed = head.load(std::memory_order_acquire);
+            if (stop.load(std::memory_order_acquire)) {
+                return false;
+            }
+            // Returns straight away if the consumer has popped since `observed`, so we can't miss it
+            if (tail.load(std::memory_order_relaxed) - observed > mask) {
+                head.wait(observed, std::memory_order_acquire);
+            }
+        }
+        return true;
+    }
+
+    /// Consumer only
+    /// @return false if it's empty
+    [[nodiscard]] bool tryPop(T& value)
+    {
+        const auto position = head.load(std::memory_order_relaxed);
+        if (position == cachedTail) {
+            cachedTail = tail.load(std::memory_order_acquire);
+            if (position == cachedTail) {
+                return false;
+            }
+        }
+        value = std::move(slots[position & mask]);
+        head.store(position + 1, std::memory_order_release);
+        head.notify_one();
+        return true;
+    }
+
+    [[nodiscard]] std::size_t capacity() const { return mask + 1; }
+
+private:
+    static constexpr std::size_t cacheLine = 64;
+
+    const std::uint32_t mask;
+    const std::unique_ptr<T[]> slots;
+
+    /// Next to pop, written by the consumer
+    alignas(cacheLine) std::atomic<std::uint32_t> head{};
+    /// Consumer's copy of `tail`
+    std::uint32_t cachedTail{};
+
+    /// Next to push, written by the producer
+    alignas(cacheLine) std::atomic<std::uint32_t> tail{};
+    /// Producer's copy of `head`
+    std::uint32_t cachedHead{};
+};
+
+} // namespace btl
@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "State.hpp"
+#include "FileUtils.hpp"
+#include <cstdint>
+#include <fmt/format.h>
+#include <nlohmann/json.hpp>
+#include <spdlog/spdlog.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+/// Bump when the layout changes, older files are then ignored
+constexpr int version = 1;
+
+/// FNV-1a
+class Hash
+{
+public:
+    void add(const std::string_view content)
+    {
+        for (const auto ch : content) {
+            value = (value ^ static_cast<unsigned char>(ch)) * 0x100000001b3ULL;
+        }
+    }
+
+    [[nodiscard]] std::string str() const { return fmt::format("{:016x}", value); }
+
+private:
+    std::uint64_t value{0xcbf29ce484222325ULL};
+};
+
+std::int64_t toJson(const fs::file_time_type time)
+{
+    return time.time_since_epoch().count();
+}
+
+fs::file_time_type fromJson(const nlohmann::json& j)
+{
+    return fs::file_time_type(fs::file_time_type::duration(j.get<std::int64_t>()));
+}
+
+} // namespace
+
+namespace btl {
+
+std::optional<State> readState(const std::filesystem::path& path, const std::string_view fingerprint)
+{
+    std::error_code ec;
+    if (!fs::exists(path, ec)) {
+        spdlog::info("No saved state, scanning everything: {}", path.string());
+        return std::nullopt;
+    }
+
+    try {
+        const auto j = nlohmann::json::parse(readFile(path));
+        if (j.at("version").get<int>() != version || j.at("fingerprint").get<std::string>() != fingerprint) {
+            spdlog::info("Saved state is for a different version or configuration, scanning everything");
+            return std::nullopt;
+        }
+
+        State state{.fingerprint = std::string(fingerprint)};
+        for (const auto& node : j.at("directories")) {
+            state.directories.emplace(
+                node.at("path").get<std::string>(),
+                State::Directory{
+                    .modified = fromJson(node.at("modified")),
+                    .files = node.at("files").get<std::vector<std::string>>(),
+                });
+        }
+        for (const auto& node : j.at("outputs")) {
+            state.outputs.emplace(
+                node.at("path").get<std::string>(),
+                State::Output{
+                    .sources = node.at("sources").get<std::string>(),
+                    .templateModified = fromJson(node.at("templateModified")),
+                    .destModified = fromJson(node.at("destModified")),
+                });
+        }
+        return state;
+    } catch (const std::exception& ex) {
+        // Only a cache, so never fatal
+        spdlog::warn("Ignoring unreadable saved state {}: {}", path.string(), ex.what());
+        return std::nullopt;
+    }
+}
+
+void writeState(const std::filesystem::path& path, const State& state)
+{
+    nlohmann::json j{
+        {"version", version},
+        {"fingerprint", state.fingerprint},
+        {"directories", nlohmann::json::array()},
+        {"outputs", nlohmann::json::array()},
+    };
+
+    auto& directories = j.at("directories");
+    for (const auto& [directory, entry] : state.directories) {
+        directories.push_back({{"path", directory}, {"modified", toJson(entry.modified)}, {"files", entry.files}});
+    }
+
+    auto& outputs = j.at("outputs");
+    for (const auto& [templatePath, output] : state.outputs) {
+        outputs.push_back({
+            {"path", templatePath},
+            {"sources", output.sources},
+            {"templateModified", toJson(output.templateModified)},
+            {"destModified", toJson(output.destModified)},
+        });
+    }
+
+    fs::create_directories(path.parent_path());
+    writeIfChanged(path, j.dump());
+}
+
+std::string digest(const std::string_view content)
+{
+    Hash hash;
+    hash.add(content);
+    return hash.str();
+}
+
+std::string digest(const std::vector<std::filesystem::path>& paths)
+{
+    Hash hash;
+    for (const auto& path : paths) {
+        hash.add(path.native());
+        // So {"ab"} and {"a", "b"} differ
+        hash.add(std::string_view("\0", 1));
+    }
+    return hash.str();
+}
+
+} // namespace btl
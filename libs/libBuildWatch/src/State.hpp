@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <filesystem>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace btl {
+
+/// What we knew about the tree when we last stopped, so the next start only has to rescan the directories that have
+/// changed since, and regenerate the templates whose inputs or outputs have.
+struct State
+{
+    struct Directory
+    {
+        /// As of when we read it, `file_time_type::min()` if we've seen it change since, so it must be rescanned
+        std::filesystem::file_time_type modified{};
+
+        /// Names of the indexed files in the directory
+        std::vector<std::string> files{};
+    };
+
+    /// What a template was last rendered from, and what it wrote
+    struct Output
+    {
+        /// Digest of the template's file list
+        std::string sources{};
+
+        std::filesystem::file_time_type templateModified{};
+
+        /// Of the generated file, so we notice if it's edited or deleted while we're not running
+        std::filesystem::file_time_type destModified{};
+
+        [[nodiscard]] bool operator==(const Output&) const = default;
+    };
+
+    /// Digest of the config and ignore rules, if they change nothing else here can be trusted
+    std::string fingerprint{};
+
+    /// Keyed on absolute path
+    std::map<std::string, Directory> directories{};
+
+    /// Keyed on absolute template path
+    std::map<std::string, Output> outputs{};
+};
+
+/// Read the state file.
+/// @param path the state file
+/// @param fingerprint what the state must have been saved with
+/// @return the state, or empty if there isn't one, it can't be read, or it was saved with a different fingerprint
+[[nodiscard]] std::optional<State> readState(const std::filesystem::path& path, std::string_view fingerprint);
+
+/// Write the state file, replacing it atomically.  Throws on error.
+void writeState(const std::filesystem::path& path, const State& state);
+
+/// A short, stable (across runs and builds), non-cryptographic digest of the content
+[[nodiscard]] std::string digest(std::string_view content);
+
+/// A digest of a list of paths
+[[nodiscard]] std::string digest(const std::vector<std::filesystem::path>& paths);
+
+} // namespace btl
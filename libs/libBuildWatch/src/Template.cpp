@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "Template.hpp"
+#include "FilesTemplate.hpp"
+#include <fmt/format.h>
+#include <mustache.hpp>
+#include <mutex>
+#include <spdlog/spdlog.h>
+#include <stdexcept>
+
+namespace btl {
+
+// https://github.com/kainjow/Mustache
+struct Template::Parsed
+{
+    kainjow::mustache::mustache tmpl;
+
+    /// Set if the template is simple enough to render without kainjow
+    std::optional<FilesTemplate> files;
+
+    /// kainjow keeps its error state in the template, so renders with it take turns
+    std::mutex mutex;
+};
+
+Template::Template(const std::string& content)
+    : parsed(std::make_unique<Parsed>(kainjow::mustache::mustache(content), FilesTemplate::compile(content)))
+{
+    if (!parsed->tmpl.is_valid()) {
+        throw std::invalid_argument(fmt::format("Invalid template: {}", parsed->tmpl.error_message()));
+    }
+    if (!parsed->files) {
+        spdlog::debug("Template needs more than a file list, rendering with the full mustache implementation");
+    }
+}
+
+Template::~Template() = default;
+Template::Template(Template&&) noexcept = default;
+Template& Template::operator=(Template&&) noexcept = default;
+
+std::string Template::render(const std::vector<std::filesystem::path>& files)
+{
+    if (parsed->files) {
+        std::string output;
+        parsed->files->render(files, output);
+        return output;
+    }
+
+    using namespace kainjow::mustache;
+    data list{data::type::list};
+
+    for (const auto& file : files) {
+        const bool isLast = (file == files.back());
+        data d;
+        d.set("relpath", file.string());
+        d.set("last", data(isLast ? data::type::bool_true : data::type::bool_false));
+        list << d;
+    }
+
+    std::scoped_lock lock(parsed->mutex);
+    auto output = parsed->tmpl.render({"files", list});
+    if (!parsed->tmpl.is_valid()) {
+        throw std::runtime_error(fmt::format("Could not render template: {}", parsed->tmpl.error_message()));
+    }
+    return output;
+}
+
+} // namespace btl
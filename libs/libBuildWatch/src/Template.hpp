@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace btl {
+
+/// A parsed mustache template, rendered with the list of files belonging to it.
+///
+/// Parsing is done once, up front, so a template can be rendered over and over as the files change.
+class Template
+{
+public:
+    /// Parse the template.  Throws if it isn't valid mustache.
+    /// @param content the template text
+    explicit Template(const std::string& content);
+
+    ~Template();
+    Template(Template&&) noexcept;
+    Template& operator=(Template&&) noexcept;
+
+    /// Render the template, with the files available as `{{#files}}{{relpath}}{{^last}} {{/last}}{{/files}}`.
+    /// Throws if rendering fails.  Safe to call from several threads at once.
+    /// @param files paths, usually relative to the template, in the order they should appear
+    [[nodiscard]] std::string render(const std::vector<std::filesystem::path>& files);
+
+private:
+    struct Parsed;
+
+    /// Keeps the mustache implementation out of the header
+    std::unique_ptr<Parsed> parsed;
+};
+
+} // namespace btl
@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "TemplateCache.hpp"
+#include "FileUtils.hpp"
+#include <spdlog/spdlog.h>
+
+namespace btl {
+
+std::shared_ptr<Template> TemplateCache::get(const std::filesystem::path& path)
+{
+    if (const auto iter = templates.find(path.string()); iter != templates.end()) {
+        return iter->second.parsed;
+    }
+
+    spdlog::info("Reading {}", path.string());
+    // Before reading, so a write while we're reading makes us stale rather than missed
+    std::error_code ec;
+    const auto modified = std::filesystem::last_write_time(path, ec);
+    auto parsed = std::make_shared<Template>(readFile(path));
+    return templates.emplace(path.string(), Entry{parsed, modified}).first->second.parsed;
+}
+
+void TemplateCache::invalidate(const std::filesystem::path& path)
+{
+    if (templates.erase(path.string())) {
+        spdlog::debug("Template changed, will re-read: {}", path.string());
+    }
+}
+
+void TemplateCache::invalidateDirectory(const std::filesystem::path& directory)
+{
+    auto prefix = directory.string();
+    if (!prefix.ends_with('/')) {
+        prefix.push_back('/');
+    }
+    std::erase_if(templates, [&prefix](const auto& entry) { return entry.first.starts_with(prefix); });
+}
+
+std::vector<std::filesystem::path> TemplateCache::invalidateModified()
+{
+    std::vector<std::filesystem::path> result;
+    std::erase_if(templates, [&result](const auto& entry) {
+        std::error_code ec;
+        if (std::filesystem::last_write_time(entry.first, ec) == entry.second.modified && !ec) {
+            return false;
+        }
+        spdlog::debug("Template changed, will re-read: {}", entry.first);
+        result.emplace_back(entry.first);
+        return true;
+    });
+    return result;
+}
+
+} // namespace btl
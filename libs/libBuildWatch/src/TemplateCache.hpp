@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "Template.hpp"
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace btl {
+
+/// Parsed templates, keyed on path, so regenerating doesn't re-read and re-parse a template that hasn't changed.
+///
+/// Nothing here watches the filesystem, so whoever sees the template change must call `invalidate`.
+class TemplateCache
+{
+public:
+    /// The parsed template, read from disk if we haven't got it.  Throws if it can't be read or parsed.  Shared, so a
+    /// render in progress elsewhere keeps it alive if it's invalidated meanwhile.
+    /// @param path path to the template file
+    [[nodiscard]] std::shared_ptr<Template> get(const std::filesystem::path& path);
+
+    /// Forget the template, so the next `get` reads it again.
+    /// @param path path to the template file
+    void invalidate(const std::filesystem::path& path);
+
+    /// Forget any templates beneath `directory`, e.g. it's been deleted or moved away.
+    void invalidateDirectory(const std::filesystem::path& directory);
+
+    /// Forget any templates modified (or gone) since we read them, for when we've missed the events that say so.
+    /// @return the templates forgotten
+    std::vector<std::filesystem::path> invalidateModified();
+
+    /// Number of templates cached
+    [[nodiscard]] std::size_t size() const { return templates.size(); }
+
+private:
+    struct Entry
+    {
+        std::shared_ptr<Template> parsed;
+
+        /// When the file was modified, as of reading it
+        std::filesystem::file_time_type modified{};
+    };
+
+    std::unordered_map<std::string, Entry> templates{};
+};
+
+} // namespace btl
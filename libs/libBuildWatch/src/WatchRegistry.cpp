@@ -0,0 +1,228 @@
+/*
+ * Copyright (c) 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "WatchRegistry.hpp"
+#include <algorithm>
+#include <functional>
+#include <utility>
+
+namespace fs = std::filesystem;
+
+namespace btl {
+
+std::size_t WatchRegistry::KeyHash::operator()(const Key& key) const
+{
+    return std::hash<std::string>{}(key.name) ^ (std::hash<std::uint32_t>{}(key.parent) * 0x9e3779b97f4a7c15ULL);
+}
+
+std::uint32_t WatchRegistry::add(const int wd, const std::filesystem::path& directory, const std::uint32_t flags)
+{
+    std::uint32_t index = freeHead;
+    if (index != none) {
+        freeHead = nextSiblings[index];
+    } else {
+        index = static_cast<std::uint32_t>(wds.size());
+        wds.push_back(-1);
+        parents.push_back(none);
+        keys.push_back(nullptr);
+        flagColumn.push_back(0);
+        firstChildren.push_back(none);
+        nextSiblings.push_back(none);
+        previousSiblings.push_back(none);
+    }
+
+    wds[index] = wd;
+    flagColumn[index] = flags;
+    nextSiblings[index] = none;
+    if (static_cast<std::size_t>(wd) >= wdIndexes.size()) {
+        wdIndexes.resize(wd + 1, none);
+    }
+    wdIndexes[wd] = index;
+    ++count;
+
+    attach(index, directory);
+    return index;
+}
+
+void WatchRegistry::move(const std::uint32_t index, const std::filesystem::path& directory)
+{
+    attach(index, directory, detach(index));
+}
+
+std::vector<int> WatchRegistry::removeSubtree(const std::uint32_t index)
+{
+    std::vector<int> removed;
+    const auto node = detach(index);
+
+    std::vector<std::uint32_t> pending{index};
+    while (!pending.empty()) {
+        const auto current = pending.back();
+        pending.pop_back();
+        for (auto child = firstChildren[current]; child != none; child = nextSiblings[child]) {
+            pending.push_back(child);
+        }
+
+        if (current != index) {
+            indexes.erase(indexes.find(*keys[current]));
+        }
+        removed.push_back(wds[current]);
+        wdIndexes[wds[current]] = none;
+        wds[current] = -1;
+        parents[current] = none;
+        keys[current] = nullptr;
+        firstChildren[current] = none;
+        previousSiblings[current] = none;
+        nextSiblings[current] = freeHead;
+        freeHead = current;
+        --count;
+    }
+    return removed;
+}
+
+std::uint32_t WatchRegistry::find(const int wd) const
+{
+    if (wd < 0 || static_cast<std::size_t>(wd) >= wdIndexes.size()) {
+        return none;
+    }
+    return wdIndexes[wd];
+}
+
+std::uint32_t WatchRegistry::find(const std::filesystem::path& directory) const
+{
+    // Usually there's only the one root
+    for (const auto root : roots) {
+        const auto relative = directory.lexically_relative(keys[root]->name);
+        if (relative.empty() || *relative.begin() == "..") {
+            continue;
+        }
+        auto index = root;
+        for (const auto& component : relative) {
+            if (component == ".") {
+                continue;
+            }
+            const auto iter = indexes.find(Key{.parent = index, .name = component.string()});
+            if (iter == indexes.end()) {
+                index = none;
+                break;
+            }
+            index = iter->second;
+        }
+        if (index != none) {
+            return index;
+        }
+    }
+    return none;
+}
+
+std::filesystem::path WatchRegistry::directory(const std::uint32_t index) const
+{
+    std::vector<const std::string*> path;
+    for (auto current = index; current != none; current = parents[current]) {
+        path.push_back(&keys[current]->name);
+    }
+
+    fs::path result(*path.back());
+    for (auto iter = path.rbegin() + 1; iter != path.rend(); ++iter) {
+        result /= **iter;
+    }
+    return result;
+}
+
+void WatchRegistry::attach(const std::uint32_t index, const std::filesystem::path& directory, Indexes::node_type node)
+{
+    if (const auto parent = find(directory.parent_path()); parent != none && parent != index) {
+        link(index, Key{.parent = parent, .name = directory.filename().string()}, std::move(node));
+    } else {
+        link(index, Key{.parent = none, .name = directory.string()}, std::move(node));
+    }
+
+    // Roots immediately beneath us, e.g. the directory was watched after its children, are ours now
+    const auto prefix = directory.string() + '/';
+    std::vector<std::uint32_t> adopted;
+    for (const auto root : roots) {
+        const auto& name = keys[root]->name;
+        if (root != index && name.starts_with(prefix) && name.find('/', prefix.size()) == std::string::npos) {
+            adopted.push_back(root);
+        }
+    }
+    for (const auto child : adopted) {
+        auto name = keys[child]->name.substr(prefix.size());
+        link(child, Key{.parent = index, .name = std::move(name)}, detach(child));
+    }
+}
+
+WatchRegistry::Indexes::node_type WatchRegistry::detach(const std::uint32_t index)
+{
+    if (const auto parent = parents[index]; parent == none) {
+        std::erase(roots, index);
+    } else {
+        const auto next = nextSiblings[index];
+        const auto previous = previousSiblings[index];
+        if (previous != none) {
+            nextSiblings[previous] = next;
+        } else {
+            firstChildren[parent] = next;
+        }
+        if (next != none) {
+            previousSiblings[next] = previous;
+        }
+    }
+    parents[index] = none;
+    nextSiblings[index] = none;
+    previousSiblings[index] = none;
+
+    auto node = indexes.extract(indexes.find(*keys[index]));
+    keys[index] = nullptr;
+    return node;
+}
+
+void WatchRegistry::link(const std::uint32_t index, Key key, Indexes::node_type node)
+{
+    // Already someone there, the directory must have been replaced before we heard it went.  The kernel has dropped
+    // their watches along with the directory.
+    if (const auto iter = indexes.find(key); iter != indexes.end()) {
+        removeSubtree(iter->second);
+    }
+
+    const auto parent = key.parent;
+    if (node) {
+        node.key() = std::move(key);
+        keys[index] = &indexes.insert(std::move(node)).position->first;
+    } else {
+        keys[index] = &indexes.emplace(std::move(key), index).first->first;
+    }
+
+    parents[index] = parent;
+    if (parent == none) {
+        roots.push_back(index);
+    } else {
+        const auto first = firstChildren[parent];
+        nextSiblings[index] = first;
+        previousSiblings[index] = none;
+        if (first != none) {
+            previousSiblings[first] = index;
+        }
+        firstChildren[parent] = index;
+    }
+}
+
+} // namespace btl
@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace btl {
+
+/// Which directory each inotify watch is on, for many thousands of watches.
+///
+/// Each watch is an index into flat columns (wd, parent, name, flags, and the links to its children), with the
+/// wd -> index lookup a vector, as the kernel hands out small wds.  Watches form a tree, each knowing only its name
+/// within its parent, so a rename changes one watch and removal only visits the subtree.  Freed indexes are reused.
+///
+/// Knows nothing about the kernel, it's up to the caller to add and remove the watches there.
+class WatchRegistry
+{
+public:
+    /// No watch, e.g. for an unknown wd or directory, or the parent of a root
+    static constexpr std::uint32_t none = std::numeric_limits<std::uint32_t>::max();
+
+    /// Register a new watch
+    /// @param wd watch descriptor, mustn't already be registered
+    /// @param directory what it's watching
+    /// @param flags the inotify mask it was added with
+    /// @return the watch's index
+    std::uint32_t add(int wd, const std::filesystem::path& directory, std::uint32_t flags);
+
+    /// The directory has moved (or was re-added elsewhere), the watches beneath it come along
+    void move(std::uint32_t index, const std::filesystem::path& directory);
+
+    /// Forget the watch and everything beneath it
+    /// @return the wds removed, for the caller to remove from the kernel
+    std::vector<int> removeSubtree(std::uint32_t index);
+
+    /// @return the watch with the wd, or `none`
+    [[nodiscard]] std::uint32_t find(int wd) const;
+
+    /// Walks down the tree from the roots, a lookup per path component
+    /// @return the watch on the directory, or `none`
+    [[nodiscard]] std::uint32_t find(const std::filesystem::path& directory) const;
+
+    /// Full path of the watched directory, built from the names of the watches above
+    [[nodiscard]] std::filesystem::path directory(std::uint32_t index) const;
+
+    [[nodiscard]] int wd(std::uint32_t index) const { return wds[index]; }
+
+    [[nodiscard]] std::uint32_t parent(std::uint32_t index) const { return parents[index]; }
+
+    [[nodiscard]] std::uint32_t flags(std::uint32_t index) const { return flagColumn[index]; }
+
+    void setFlags(std::uint32_t index, std::uint32_t flags) { flagColumn[index] = flags; }
+
+    /// Number of watches
+    [[nodiscard]] std::size_t size() const { return count; }
+
+private:
+    /// A watch's place in the tree, owned by `indexes`.  Node based, so `keys` can point into it.
+    struct Key
+    {
+        std::uint32_t parent{none};
+
+        /// Within the parent, or the full path for a root
+        std::string name{};
+
+        [[nodiscard]] bool operator==(const Key&) const = default;
+    };
+
+    struct KeyHash
+    {
+        [[nodiscard]] std::size_t operator()(const Key& key) const;
+    };
+
+    using Indexes = std::unordered_map<Key, std::uint32_t, KeyHash>;
+
+    /// Put the watch at `directory` in the tree, under the watch on its parent directory if there is one, and adopt
+    /// any roots immediately beneath it.
+    /// @param node the watch's old entry in `indexes`, if it has one
+    void attach(std::uint32_t index, const std::filesystem::path& directory, Indexes::node_type node = {});
+
+    /// Take the watch out of the tree, its children stay with it
+    /// @return its entry in `indexes`, to be reused by `link`
+    [[nodiscard]] Indexes::node_type detach(std::uint32_t index);
+
+    /// Put the watch in the tree at `key`, dropping any stale watch already there
+    void link(std::uint32_t index, Key key, Indexes::node_type node);
+
+    /// wd -> index, `none` for wds we don't have
+    std::vector<std::uint32_t> wdIndexes{};
+
+    // Columns, indexed by watch
+    std::vector<int> wds{};
+    std::vector<std::uint32_t> parents{};
+    std::vector<const Key*> keys{};
+    std::vector<std::uint32_t> flagColumn{};
+    std::vector<std::uint32_t> firstChildren{};
+    std::vector<std::uint32_t> nextSiblings{};
+    std::vector<std::uint32_t> previousSiblings{};
+
+    /// (parent, name) -> index
+    Indexes indexes{};
+
+    /// Watches whose parent directory isn't watched, usually just the root we were asked to watch
+    std::vector<std::uint32_t> roots{};
+
+    /// Freed indexes, chained through `nextSiblings`
+    std::uint32_t freeHead{none};
+
+    std::size_t count{};
+};
+
+} // namespace btl
@@ -1,6 +1,10 @@
 #include <TestHelpers/TempDirectory.hpp>
 #include "BuildWatch.hpp"
+#include "INotify.hpp"
 #include <fstream>
+#include <memory>
+#include <sstream>
+#include <thread>
 #include <gtest/gtest.h>
 #include <spdlog/spdlog.h>
 
@@ -18,3 +22,362 @@ TEST(BuildWatchTest, defaultConfig)
     ASSERT_FALSE(watcher.defaultConfig().empty());
     ASSERT_GT(watcher.defaultConfig().size(), 0);
 }
+
+TEST(BuildWatchTest, regeneratesOnceEventsGoQuiet)
+{
+    using namespace btl;
+    using namespace std::chrono_literals;
+    namespace fs = std::filesystem;
+
+    const TempDirectory tempDirectory;
+    const auto library = tempDirectory.path() / "lib";
+    fs::create_directory(library);
+    std::ofstream(library / "CMakeLists.txt.mustache") << "{{#files}}{{relpath}}\n{{/files}}";
+
+    Config config{{TemplateFile::defaultConfiguration()}, {}};
+    config.debounce = 20ms;
+    BuildWatch watcher(tempDirectory.path(), config, false);
+
+    constexpr int fileCount = 20;
+    for (int i = 0; i < fileCount; ++i) {
+        std::ofstream(library / fmt::format("file{:02}.cpp", i)) << "";
+    }
+
+    const auto generated = library / "CMakeLists.txt";
+    for (int i = 0; i < 100 && !fs::exists(generated); ++i) {
+        watcher.watchOnce(50ms);
+    }
+
+    std::ifstream is(generated);
+    std::stringstream content;
+    content << is.rdbuf();
+    ASSERT_TRUE(content.str().starts_with("file00.cpp\nfile01.cpp\n"));
+    ASSERT_TRUE(content.str().ends_with("file19.cpp\n"));
+}
+
+TEST(BuildWatchTest, writesQueuedTemplatesOnDestruction)
+{
+    using namespace btl;
+    using namespace std::chrono_literals;
+    namespace fs = std::filesystem;
+
+    const TempDirectory tempDirectory;
+    const auto library = tempDirectory.path() / "lib";
+    fs::create_directory(library);
+    std::ofstream(library / "CMakeLists.txt.mustache") << "{{#files}}{{relpath}}\n{{/files}}";
+
+    const auto generated = library / "CMakeLists.txt";
+    {
+        // Never goes quiet for long enough
+        Config config{{TemplateFile::defaultConfiguration()}, {}};
+        config.debounce = 1h;
+        BuildWatch watcher(tempDirectory.path(), config, false);
+
+        std::ofstream(library / "a.cpp") << "";
+        for (int i = 0; i < 5; ++i) {
+            watcher.watchOnce(50ms);
+        }
+        ASSERT_FALSE(fs::exists(generated));
+    }
+
+    std::ifstream is(generated);
+    std::stringstream content;
+    content << is.rdbuf();
+    ASSERT_EQ(content.str(), "a.cpp\n");
+}
+
+TEST(BuildWatchTest, pollsDirectoriesItCannotWatch)
+{
+    using namespace btl;
+    using namespace std::chrono_literals;
+    namespace fs = std::filesystem;
+
+    const TempDirectory tempDirectory;
+    const auto library = tempDirectory.path() / "lib";
+    fs::create_directories(library / "src");
+    std::ofstream(library / "CMakeLists.txt.mustache") << "{{#files}}{{relpath}}\n{{/files}}";
+
+    // Only enough watches for the root, so lib and lib/src get polled
+    Config config{{TemplateFile::defaultConfiguration()}, {}};
+    config.debounce = 10ms;
+    config.maxWatches = 1;
+    config.pollInterval = 20ms;
+    BuildWatch watcher(tempDirectory.path(), config, false);
+
+    // Directory modification times only move on with the kernel's clock tick
+    std::this_thread::sleep_for(20ms);
+    std::ofstream(library / "src/a.cpp") << "";
+
+    const auto generated = library / "CMakeLists.txt";
+    for (int i = 0; i < 100 && !fs::exists(generated); ++i) {
+        watcher.watchOnce(50ms);
+    }
+
+    std::ifstream is(generated);
+    std::stringstream content;
+    content << is.rdbuf();
+    ASSERT_EQ(content.str(), "src/a.cpp\n");
+}
+
+TEST(BuildWatchTest, regeneratesFromFanotifyEvents)
+{
+    using namespace btl;
+    using namespace std::chrono_literals;
+    namespace fs = std::filesystem;
+
+    const TempDirectory tempDirectory;
+    const auto library = tempDirectory.path() / "lib";
+    fs::create_directories(library / "src");
+    std::ofstream(library / "CMakeLists.txt.mustache") << "{{#files}}{{relpath}}\n{{/files}}";
+
+    // Falls back to inotify if we can't have fanotify, either way the result is the same
+    Config config{{TemplateFile::defaultConfiguration()}, {}};
+    config.debounce = 10ms;
+    config.eventSource = "fanotify";
+    BuildWatch watcher(tempDirectory.path(), config, false);
+
+    std::ofstream(library / "src/a.cpp") << "";
+
+    const auto generated = library / "CMakeLists.txt";
+    for (int i = 0; i < 100 && !fs::exists(generated); ++i) {
+        watcher.watchOnce(50ms);
+    }
+
+    std::ifstream is(generated);
+    std::stringstream content;
+    content << is.rdbuf();
+    ASSERT_EQ(content.str(), "src/a.cpp\n");
+}
+
+TEST(BuildWatchTest, regeneratesFromFanotifyEventsUnderARelativeRoot)
+{
+    using namespace btl;
+    using namespace std::chrono_literals;
+    namespace fs = std::filesystem;
+
+    const TempDirectory tempDirectory;
+    const auto library = tempDirectory.path() / "tree/lib";
+    fs::create_directories(library / "src");
+    std::ofstream(library / "CMakeLists.txt.mustache") << "{{#files}}{{relpath}}\n{{/files}}";
+
+    Config config{{TemplateFile::defaultConfiguration()}, {}};
+    config.debounce = 10ms;
+    config.eventSource = "fanotify";
+
+    // As given on the command line, relative and with a trailing slash
+    const auto previous = fs::current_path();
+    fs::current_path(tempDirectory.path());
+    std::unique_ptr<BuildWatch> watcher;
+    try {
+        watcher = std::make_unique<BuildWatch>("./tree/", config, false);
+    } catch (...) {
+        fs::current_path(previous);
+        throw;
+    }
+    fs::current_path(previous);
+
+    std::ofstream(library / "src/a.cpp") << "";
+
+    const auto generated = library / "CMakeLists.txt";
+    for (int i = 0; i < 100 && !fs::exists(generated); ++i) {
+        watcher->watchOnce(50ms);
+    }
+
+    std::ifstream is(generated);
+    std::stringstream content;
+    content << is.rdbuf();
+    ASSERT_EQ(content.str(), "src/a.cpp\n");
+}
+
+TEST(BuildWatchTest, resyncsAfterOverflow)
+{
+    using namespace btl;
+    using namespace std::chrono_literals;
+    namespace fs = std::filesystem;
+
+    std::size_t maxQueuedEvents{};
+    std::ifstream("/proc/sys/fs/inotify/max_queued_events") >> maxQueuedEvents;
+    if (maxQueuedEvents == 0 || maxQueuedEvents > 65536) {
+        GTEST_SKIP() << "Too many files needed to overflow the queue: " << maxQueuedEvents;
+    }
+
+    const TempDirectory tempDirectory;
+    const auto library = tempDirectory.path() / "lib";
+    const auto other = tempDirectory.path() / "other";
+    fs::create_directories(library);
+    fs::create_directories(other);
+    std::ofstream(library / "CMakeLists.txt.mustache") << "{{#files}}{{relpath}}\n{{/files}}";
+    std::ofstream(other / "CMakeLists.txt.mustache") << "{{#files}}{{relpath}}\n{{/files}}";
+
+    Config config{{TemplateFile::defaultConfiguration()}, {}};
+    config.debounce = 10ms;
+    BuildWatch watcher(tempDirectory.path(), config, false);
+
+    // More events than the kernel, and our reader thread, will queue, so the last ones are lost
+    const auto fileCount = maxQueuedEvents + INotify::ringCapacity + 100;
+    for (std::size_t i = 0; i < fileCount; ++i) {
+        std::ofstream(library / fmt::format("{:06}.cpp", i)) << "";
+    }
+
+    // The reader thread may keep up for a while, so it's written more than once
+    const auto generated = library / "CMakeLists.txt";
+    const auto lines = [&generated] {
+        std::ifstream is(generated);
+        std::size_t count = 0;
+        for (std::string line; std::getline(is, line);) {
+            ++count;
+        }
+        return count;
+    };
+    for (int i = 0; i < 100 && lines() != fileCount; ++i) {
+        watcher.watchOnce(50ms);
+    }
+    ASSERT_EQ(lines(), fileCount);
+
+    // Nothing changed there, so it isn't regenerated
+    ASSERT_FALSE(fs::exists(other / "CMakeLists.txt"));
+}
+
+TEST(BuildWatchTest, restoresSavedState)
+{
+    using namespace btl;
+    using namespace std::chrono_literals;
+    namespace fs = std::filesystem;
+
+    const TempDirectory tempDirectory;
+    const auto library = tempDirectory.path() / "lib";
+    fs::create_directories(library / "src");
+    std::ofstream(library / "CMakeLists.txt.mustache") << "{{#files}}{{relpath}}\n{{/files}}";
+    std::ofstream(library / "src/a.cpp") << "";
+
+    Config config{{TemplateFile::defaultConfiguration()}, {}};
+    config.debounce = 10ms;
+    config.stateFile = ".config/BuildWatch/state.json";
+
+    const auto generated = library / "CMakeLists.txt";
+    const auto contents = [&generated] {
+        std::ifstream is(generated);
+        std::stringstream content;
+        content << is.rdbuf();
+        return content.str();
+    };
+    const auto run = [&](const auto& until) {
+        BuildWatch watcher(tempDirectory.path(), config, false);
+        for (int i = 0; i < 20 && !until(); ++i) {
+            watcher.watchOnce(20ms);
+        }
+    };
+
+    // Nothing saved, so nothing to compare against, just scan
+    run([] { return false; });
+    ASSERT_TRUE(fs::exists(tempDirectory.path() / config.stateFile));
+    ASSERT_FALSE(fs::exists(generated));
+
+    // Changes made while we weren't running are picked up from the saved state.  Directory modification times only
+    // move on with the kernel's clock tick.
+    std::this_thread::sleep_for(20ms);
+    std::ofstream(library / "src/b.cpp") << "";
+    run([&] { return fs::exists(generated); });
+    ASSERT_EQ(contents(), "src/a.cpp\nsrc/b.cpp\n");
+
+    // As are edits to the generated file
+    std::ofstream(generated) << "edited";
+    fs::last_write_time(generated, fs::last_write_time(generated) + 1s);
+    run([&] { return contents() != "edited"; });
+    ASSERT_EQ(contents(), "src/a.cpp\nsrc/b.cpp\n");
+
+    // And nothing is regenerated if nothing changed, which we can tell by sneaking in an edit that isn't noticed
+    const auto written = fs::last_write_time(generated);
+    std::ofstream(generated) << "sneaky";
+    fs::last_write_time(generated, written);
+    run([] { return false; });
+    ASSERT_EQ(contents(), "sneaky");
+}
+
+TEST(BuildWatchTest, watchesDirectoriesMovedIn)
+{
+    using namespace btl;
+    using namespace std::chrono_literals;
+    namespace fs = std::filesystem;
+
+    const TempDirectory tempDirectory;
+    const TempDirectory outside;
+    const auto library = tempDirectory.path() / "lib";
+    fs::create_directories(library);
+    fs::create_directories(outside.path() / "incoming/src");
+    std::ofstream(library / "CMakeLists.txt.mustache") << "{{#files}}{{relpath}}\n{{/files}}";
+    std::ofstream(outside.path() / "incoming/src/a.cpp") << "";
+
+    Config config{{TemplateFile::defaultConfiguration()}, {}};
+    config.debounce = 10ms;
+    BuildWatch watcher(tempDirectory.path(), config, false);
+
+    const auto generated = library / "CMakeLists.txt";
+    const auto contents = [&generated] {
+        std::ifstream is(generated);
+        std::stringstream content;
+        content << is.rdbuf();
+        return content.str();
+    };
+    const auto waitFor = [&](const std::string& expected) {
+        for (int i = 0; i < 100 && contents() != expected; ++i) {
+            watcher.watchOnce(20ms);
+        }
+    };
+
+    // No "moved from" to pair with, so it's watched from scratch
+    fs::rename(outside.path() / "incoming", library / "incoming");
+    waitFor("incoming/src/a.cpp\n");
+    ASSERT_EQ(contents(), "incoming/src/a.cpp\n");
+
+    std::ofstream(library / "incoming/src/b.cpp") << "";
+    waitFor("incoming/src/a.cpp\nincoming/src/b.cpp\n");
+    ASSERT_EQ(contents(), "incoming/src/a.cpp\nincoming/src/b.cpp\n");
+
+    // And moving it within the tree keeps the watches
+    fs::rename(library / "incoming", library / "moved");
+    waitFor("moved/src/a.cpp\nmoved/src/b.cpp\n");
+    std::ofstream(library / "moved/src/c.cpp") << "";
+    waitFor("moved/src/a.cpp\nmoved/src/b.cpp\nmoved/src/c.cpp\n");
+    ASSERT_EQ(contents(), "moved/src/a.cpp\nmoved/src/b.cpp\nmoved/src/c.cpp\n");
+}
+
+TEST(BuildWatchTest, regeneratesTemplatesInParallel)
+{
+    using namespace btl;
+    using namespace std::chrono_literals;
+    namespace fs = std::filesystem;
+
+    const TempDirectory tempDirectory;
+    const auto library = tempDirectory.path() / "lib";
+    fs::create_directories(library / "src");
+    std::ofstream(library / "CMakeLists.txt.mustache") << "{{#files}}{{relpath}}\n{{/files}}";
+    std::ofstream(library / "BUILD.mustache") << "{{#files}}\"{{relpath}}\"{{^last}}, {{/last}}{{/files}}";
+
+    // One change dirties both templates, which then render at once
+    Config config{{TemplateFile::defaultConfiguration(), {"BUILD.mustache", "BUILD", {".cpp", ".hpp", ".h"}}}, {}};
+    config.debounce = 10ms;
+    config.renderThreads = 2;
+    BuildWatch watcher(tempDirectory.path(), config, false);
+
+    std::ofstream(library / "src/a.cpp") << "";
+    std::ofstream(library / "src/b.hpp") << "";
+
+    const auto contents = [](const fs::path& path) {
+        std::ifstream is(path);
+        std::stringstream content;
+        content << is.rdbuf();
+        return content.str();
+    };
+    const std::string expectedCMake = "src/a.cpp\nsrc/b.hpp\n";
+    const std::string expectedBuild = R"("src/a.cpp", "src/b.hpp")";
+    for (int i = 0; i < 100
+                    && (contents(library / "CMakeLists.txt") != expectedCMake
+                        || contents(library / "BUILD") != expectedBuild);
+         ++i) {
+        watcher.watchOnce(20ms);
+    }
+
+    ASSERT_EQ(contents(library / "CMakeLists.txt"), expectedCMake);
+    ASSERT_EQ(contents(library / "BUILD"), expectedBuild);
+}
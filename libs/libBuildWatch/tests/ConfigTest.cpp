@@ -62,7 +62,7 @@ TEST(ConfigTest, serializationAndEquality)
     btl::to_json(expectedJson, expectedConfig);
     const std::string actual = expectedJson.dump();
     const std::string expected
-        = R"({"files":[{"dest":"dest.txt","extensions":[".cpp",".hpp"],"src":"src.txt"},{"dest":"py.dest.txt","extensions":[".py"],"src":"py.src.txt"}],"ignoreFiles":[]})";
+        = R"({"debounceMs":50,"eventSource":"inotify","files":[{"dest":"dest.txt","extensions":[".cpp",".hpp"],"src":"src.txt"},{"dest":"py.dest.txt","extensions":[".py"],"src":"py.src.txt"}],"ignoreFiles":[],"maxLatencyMs":500,"maxWatches":0,"pollIntervalMs":2000,"readBufferSize":65536,"renderThreads":0,"stateFile":""})";
     ASSERT_EQ(actual, expected);
 
     nlohmann::json actualJson = nlohmann::json::parse(actual);
@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "Debouncer.hpp"
+#include <gtest/gtest.h>
+#include <string>
+
+TEST(DebouncerTest, coalescesAndWaitsForQuietPeriod)
+{
+    using namespace std::chrono_literals;
+    btl::Debouncer<std::string, int> debouncer(50ms, 200ms);
+    const auto start = btl::Debouncer<std::string, int>::Clock::now();
+
+    ASSERT_TRUE(debouncer.empty());
+    ASSERT_FALSE(debouncer.timeUntilDue(start));
+
+    debouncer.add("a", 1, start);
+    debouncer.add("b", 2, start + 10ms);
+    debouncer.add("a", 3, start + 20ms);
+
+    ASSERT_FALSE(debouncer.due(start + 60ms));
+    ASSERT_EQ(debouncer.timeUntilDue(start + 60ms), 10ms);
+    ASSERT_TRUE(debouncer.due(start + 70ms));
+
+    const auto batch = debouncer.take();
+    ASSERT_EQ(batch.size(), 2);
+    ASSERT_EQ(batch.at(0), std::make_pair(std::string("a"), 3));
+    ASSERT_EQ(batch.at(1), std::make_pair(std::string("b"), 2));
+    ASSERT_TRUE(debouncer.empty());
+}
+
+TEST(DebouncerTest, maxLatencyCapsDelay)
+{
+    using namespace std::chrono_literals;
+    btl::Debouncer<std::string, int> debouncer(50ms, 100ms);
+    const auto start = btl::Debouncer<std::string, int>::Clock::now();
+
+    // Keep adding inside the quiet period
+    for (auto offset = 0ms; offset <= 90ms; offset += 30ms) {
+        debouncer.add("a", 1, start + offset);
+    }
+
+    ASSERT_FALSE(debouncer.due(start + 99ms));
+    ASSERT_TRUE(debouncer.due(start + 100ms));
+}
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "Diff.hpp"
+#include <fmt/format.h>
+#include <gtest/gtest.h>
+
+TEST(DiffTest, sameTextHasNoDiff)
+{
+    const auto diff = btl::diffLines("a\nb\n", "a\nb\n", "old", "new");
+    ASSERT_TRUE(diff.text.empty());
+    ASSERT_EQ(diff.added, 0);
+    ASSERT_EQ(diff.removed, 0);
+}
+
+TEST(DiffTest, matchesDiffU)
+{
+    // As `diff -u old new` prints it, less the timestamps
+    const auto diff = btl::diffLines(
+        "a.cpp\nb.cpp\nc.cpp\nd.cpp\ne.cpp\nf.cpp\ng.cpp\nh.cpp\ni.cpp\nj.cpp\nk.cpp\nl.cpp\n",
+        "a.cpp\nb.cpp\nbb.cpp\nc.cpp\nd.cpp\ne.cpp\nf.cpp\ng.cpp\nh.cpp\ni.cpp\nj.cpp\nl.cpp\nm.cpp\n",
+        "old",
+        "new");
+    ASSERT_EQ(
+        diff.text,
+        "--- old\n"
+        "+++ new\n"
+        "@@ -1,5 +1,6 @@\n"
+        " a.cpp\n"
+        " b.cpp\n"
+        "+bb.cpp\n"
+        " c.cpp\n"
+        " d.cpp\n"
+        " e.cpp\n"
+        "@@ -8,5 +9,5 @@\n"
+        " h.cpp\n"
+        " i.cpp\n"
+        " j.cpp\n"
+        "-k.cpp\n"
+        " l.cpp\n"
+        "+m.cpp\n");
+    ASSERT_EQ(diff.added, 2);
+    ASSERT_EQ(diff.removed, 1);
+}
+
+TEST(DiffTest, emptyBefore)
+{
+    const auto diff = btl::diffLines("", "a\nb\n", "old", "new");
+    ASSERT_EQ(diff.text, "--- old\n+++ new\n@@ -0,0 +1,2 @@\n+a\n+b\n");
+}
+
+TEST(DiffTest, givesUpOnHugeDifferences)
+{
+    std::string before;
+    std::string after;
+    for (int i = 0; i < 3000; ++i) {
+        before += fmt::format("before{}\n", i);
+        after += fmt::format("after{}\n", i);
+    }
+
+    const auto diff = btl::diffLines(before, after, "old", "new");
+    ASSERT_EQ(diff.added, 3000);
+    ASSERT_EQ(diff.removed, 3000);
+}
+
+TEST(DiffTest, flagsMissingNewlineAtEnd)
+{
+    // As `diff -u old new` prints it
+    const auto diff = btl::diffLines("a\nb\n", "a\nb", "old", "new");
+    ASSERT_EQ(diff.text, "--- old\n+++ new\n@@ -1,2 +1,2 @@\n a\n-b\n+b\n\\ No newline at end of file\n");
+    ASSERT_EQ(diff.added, 1);
+    ASSERT_EQ(diff.removed, 1);
+
+    const auto restored = btl::diffLines("a\nb", "a\nb\n", "old", "new");
+    ASSERT_EQ(restored.text, "--- old\n+++ new\n@@ -1,2 +1,2 @@\n a\n-b\n\\ No newline at end of file\n+b\n");
+}
+
+TEST(DiffTest, showsLineEndingDifferences)
+{
+    const auto diff = btl::diffLines("a\r\nb\r\n", "a\r\nb\n", "old", "new");
+    ASSERT_EQ(diff.text, "--- old\n+++ new\n@@ -1,2 +1,2 @@\n a^M\n-b^M\n+b\n");
+    ASSERT_EQ(diff.added, 1);
+    ASSERT_EQ(diff.removed, 1);
+}
@@ -0,0 +1,228 @@
+/*
+ * Copyright (c) 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "EventSource.hpp"
+#include "FanotifyEventSource.hpp"
+#include <TestHelpers/TempDirectory.hpp>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <sys/mount.h>
+#include <system_error>
+
+namespace {
+/// Create a file in the root, and wait for the source to tell us about it
+void expectCreated(
+    btl::EventSource& source, const std::vector<btl::FileEvent>& events, const std::filesystem::path& file)
+{
+    using namespace std::chrono_literals;
+
+    std::ofstream(file) << "";
+    for (int i = 0; i < 20 && events.empty(); ++i) {
+        source.watchOnce(50ms);
+    }
+
+    ASSERT_FALSE(events.empty());
+    EXPECT_EQ(events.front().type, btl::FileEvent::Type::Created);
+    EXPECT_FALSE(events.front().isDirectory);
+    EXPECT_EQ(events.front().path(), file);
+}
+} // namespace
+
+TEST(EventSourceTest, inotifyReportsCreatedFiles)
+{
+    const btl::TempDirectory tempDirectory;
+    btl::Config config;
+    config.eventSource = "inotify";
+
+    std::vector<btl::FileEvent> events;
+    const auto source = btl::makeEventSource(
+        config, tempDirectory.path(), {}, [&events](const btl::FileEvent& event) { events.push_back(event); });
+    const auto report = source->addDirectories({tempDirectory.path()});
+    ASSERT_EQ(report.obtained, 1);
+
+    expectCreated(*source, events, tempDirectory.path() / "a.cpp");
+}
+
+TEST(EventSourceTest, fanotifyReportsCreatedFiles)
+{
+    const btl::TempDirectory tempDirectory;
+    btl::Config config;
+
+    std::vector<btl::FileEvent> events;
+    std::unique_ptr<btl::EventSource> source;
+    try {
+        source = std::make_unique<btl::FanotifyEventSource>(
+            config, tempDirectory.path(), btl::SkipDirectory{}, [&events](const btl::FileEvent& event) {
+                events.push_back(event);
+            });
+    } catch (const std::system_error& e) {
+        GTEST_SKIP() << "fanotify is not available: " << e.what();
+    }
+
+    expectCreated(*source, events, tempDirectory.path() / "a.cpp");
+}
+
+TEST(EventSourceTest, fanotifyOrdersMergedEventsByWhatIsThereNow)
+{
+    using namespace std::chrono_literals;
+    namespace fs = std::filesystem;
+    const btl::TempDirectory tempDirectory;
+    btl::Config config;
+
+    std::vector<btl::FileEvent> events;
+    std::unique_ptr<btl::EventSource> source;
+    try {
+        source = std::make_unique<btl::FanotifyEventSource>(
+            config, tempDirectory.path(), btl::SkipDirectory{}, [&events](const btl::FileEvent& event) {
+                events.push_back(event);
+            });
+    } catch (const std::system_error& e) {
+        GTEST_SKIP() << "fanotify is not available: " << e.what();
+    }
+
+    const auto saved = tempDirectory.path() / "saved.cpp";
+    const auto recreated = tempDirectory.path() / "recreated.cpp";
+    const auto temporary = tempDirectory.path() / "temporary.cpp";
+    std::ofstream(saved) << "";
+    std::ofstream(recreated) << "";
+    for (int i = 0; i < 20 && events.size() < 2; ++i) {
+        source->watchOnce(50ms);
+    }
+    events.clear();
+
+    // Nothing read in between, so each name's events are merged into one
+    fs::rename(saved, tempDirectory.path() / "saved.cpp~"); // As vim saves
+    std::ofstream(saved) << "new";
+    fs::remove(recreated);
+    std::ofstream(recreated) << "new";
+    std::ofstream(temporary) << "";
+    fs::remove(temporary);
+    for (int i = 0; i < 5; ++i) {
+        source->watchOnce(50ms);
+    }
+
+    using enum btl::FileEvent::Type;
+    const auto typesFor = [&events](const fs::path& path) {
+        std::vector<btl::FileEvent::Type> types;
+        for (const auto& event : events) {
+            if (event.path() == path) {
+                types.push_back(event.type);
+            }
+        }
+        return types;
+    };
+
+    // Whatever else, they end with the file there
+    const auto savedTypes = typesFor(saved);
+    ASSERT_FALSE(savedTypes.empty());
+    EXPECT_EQ(savedTypes.front(), MovedFrom);
+    EXPECT_NE(std::ranges::find(savedTypes, Created), savedTypes.end());
+    EXPECT_EQ(std::ranges::count(savedTypes, MovedFrom), 1);
+
+    const auto recreatedTypes = typesFor(recreated);
+    ASSERT_FALSE(recreatedTypes.empty());
+    EXPECT_EQ(recreatedTypes.front(), Deleted);
+    EXPECT_NE(std::ranges::find(recreatedTypes, Created), recreatedTypes.end());
+    EXPECT_EQ(std::ranges::count(recreatedTypes, Deleted), 1);
+
+    // And that one ends gone
+    const auto temporaryTypes = typesFor(temporary);
+    ASSERT_FALSE(temporaryTypes.empty());
+    EXPECT_EQ(temporaryTypes.back(), Deleted);
+}
+
+TEST(EventSourceTest, fanotifyOnlyReportsModifiedTemplates)
+{
+    using namespace std::chrono_literals;
+    const btl::TempDirectory tempDirectory;
+    btl::Config config;
+    config.files = {btl::TemplateFile::defaultConfiguration()};
+
+    const auto source = tempDirectory.path() / "a.cpp";
+    const auto templatePath = tempDirectory.path() / config.files.front().src;
+    std::ofstream(source) << "";
+    std::ofstream(templatePath) << "";
+
+    std::vector<btl::FileEvent> events;
+    std::unique_ptr<btl::EventSource> eventSource;
+    try {
+        eventSource = std::make_unique<btl::FanotifyEventSource>(
+            config, tempDirectory.path(), btl::SkipDirectory{}, [&events](const btl::FileEvent& event) {
+                events.push_back(event);
+            });
+    } catch (const std::system_error& e) {
+        GTEST_SKIP() << "fanotify is not available: " << e.what();
+    }
+    eventSource->addDirectories({tempDirectory.path()});
+
+    std::ofstream(source, std::ios::app) << "int a;";
+    std::ofstream(templatePath, std::ios::app) << "{{#files}}";
+    for (int i = 0; i < 20 && events.empty(); ++i) {
+        eventSource->watchOnce(50ms);
+    }
+    eventSource->watchOnce(50ms);
+
+    ASSERT_EQ(events.size(), 1);
+    EXPECT_EQ(events.front().type, btl::FileEvent::Type::Modified);
+    EXPECT_EQ(events.front().path(), templatePath);
+}
+
+TEST(EventSourceTest, fanotifyRefusesMountsBeneathTheRoot)
+{
+    const btl::TempDirectory tempDirectory;
+    const auto mountPoint = tempDirectory.path() / "mounted";
+    std::filesystem::create_directory(mountPoint);
+    if (mount("tmpfs", mountPoint.c_str(), "tmpfs", 0, nullptr) != 0) {
+        GTEST_SKIP() << "Could not mount a tmpfs: " << strerror(errno);
+    }
+
+    btl::Config config;
+    EXPECT_THROW(
+        btl::FanotifyEventSource(config, tempDirectory.path(), btl::SkipDirectory{}, btl::FileEventCallback{}),
+        std::system_error);
+
+    umount(mountPoint.c_str());
+}
+
+TEST(EventSourceTest, fanotifyFallsBackToINotify)
+{
+    const btl::TempDirectory tempDirectory;
+    btl::Config config;
+    config.eventSource = "fanotify";
+
+    // Whichever we get, it behaves the same
+    std::vector<btl::FileEvent> events;
+    const auto source = btl::makeEventSource(
+        config, tempDirectory.path(), {}, [&events](const btl::FileEvent& event) { events.push_back(event); });
+    source->addDirectories({tempDirectory.path()});
+
+    expectCreated(*source, events, tempDirectory.path() / "a.cpp");
+}
+
+TEST(EventSourceTest, unknownSourceThrows)
+{
+    btl::Config config;
+    config.eventSource = "kqueue";
+    ASSERT_THROW((void) btl::makeEventSource(config, std::filesystem::current_path(), {}, {}), std::invalid_argument);
+}
@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "FileIndex.hpp"
+#include "FileUtils.hpp"
+#include <TestHelpers/TempDirectory.hpp>
+#include <fstream>
+#include <gmock/gmock-matchers.h>
+#include <gtest/gtest.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+void touch(const fs::path& path)
+{
+    fs::create_directories(path.parent_path());
+    std::ofstream(path) << "";
+}
+
+btl::FileIndex indexTree(const fs::path& root)
+{
+    btl::FileIndex index({btl::TemplateFile::defaultConfiguration()});
+    for (const auto& entry : fs::recursive_directory_iterator(root)) {
+        if (entry.is_regular_file()) {
+            index.add(entry.path());
+        }
+    }
+    return index;
+}
+} // namespace
+
+TEST(FileIndexTest, matchesFilesystemWalk)
+{
+    const btl::TempDirectory root;
+    const auto templateFile = btl::TemplateFile::defaultConfiguration();
+
+    touch(root.path() / "lib/CMakeLists.txt.mustache");
+    touch(root.path() / "lib/src/a.cpp");
+    touch(root.path() / "lib/src/a.hpp");
+    touch(root.path() / "lib/src/notes.txt");
+    touch(root.path() / "lib/include/b.h");
+    touch(root.path() / "lib/tests/CMakeLists.txt.mustache");
+    touch(root.path() / "lib/tests/aTest.cpp");
+    // Not beneath lib/tests, despite the name, and sorts before lib/src/
+    touch(root.path() / "lib/tests-data/c.cpp");
+    touch(root.path() / "lib/src-gen/d.cpp");
+
+    const auto index = indexTree(root);
+    const auto libTemplate = root.path() / "lib/CMakeLists.txt.mustache";
+    const auto testsTemplate = root.path() / "lib/tests/CMakeLists.txt.mustache";
+
+    ASSERT_THAT(
+        index.files(templateFile, libTemplate),
+        testing::ElementsAre("include/b.h", "src-gen/d.cpp", "src/a.cpp", "src/a.hpp", "tests-data/c.cpp"));
+    ASSERT_EQ(index.files(templateFile, libTemplate), btl::getAllFiles(libTemplate, templateFile.extensions));
+
+    ASSERT_THAT(index.files(templateFile, testsTemplate), testing::ElementsAre("aTest.cpp"));
+    ASSERT_EQ(index.files(templateFile, testsTemplate), btl::getAllFiles(testsTemplate, templateFile.extensions));
+}
+
+TEST(FileIndexTest, incrementalUpdates)
+{
+    const btl::TempDirectory root;
+    const auto templateFile = btl::TemplateFile::defaultConfiguration();
+    const auto libTemplate = root.path() / "lib/CMakeLists.txt.mustache";
+    const auto nestedTemplate = root.path() / "lib/sub/CMakeLists.txt.mustache";
+
+    btl::FileIndex index({templateFile});
+    index.add(libTemplate);
+    index.add(root.path() / "lib/a.cpp");
+    index.add(root.path() / "lib/sub/b.cpp");
+    index.add(root.path() / "lib/sub/deeper/c.cpp");
+    ASSERT_TRUE(index.hasTemplate(libTemplate));
+    ASSERT_THAT(index.files(templateFile, libTemplate), testing::ElementsAre("a.cpp", "sub/b.cpp", "sub/deeper/c.cpp"));
+
+    // A nested template takes ownership of the files beneath it
+    index.add(nestedTemplate);
+    ASSERT_THAT(index.files(templateFile, libTemplate), testing::ElementsAre("a.cpp"));
+    ASSERT_THAT(index.files(templateFile, nestedTemplate), testing::ElementsAre("b.cpp", "deeper/c.cpp"));
+
+    index.remove(root.path() / "lib/sub/b.cpp");
+    ASSERT_THAT(index.files(templateFile, nestedTemplate), testing::ElementsAre("deeper/c.cpp"));
+
+    // And gives them back when it goes away
+    index.remove(nestedTemplate);
+    ASSERT_THAT(index.files(templateFile, libTemplate), testing::ElementsAre("a.cpp", "sub/deeper/c.cpp"));
+
+    index.removeDirectory(root.path() / "lib/sub");
+    ASSERT_THAT(index.files(templateFile, libTemplate), testing::ElementsAre("a.cpp"));
+    ASSERT_EQ(index.size(), 1);
+}
+
+TEST(FileIndexTest, findTemplateMatchesFindUp)
+{
+    const btl::TempDirectory root;
+    const std::string src = btl::TemplateFile::defaultConfiguration().src;
+
+    touch(root.path() / "lib" / src);
+    touch(root.path() / "lib/tests" / src);
+    fs::create_directories(root.path() / "lib/src/deeper/still");
+    fs::create_directories(root.path() / "lib/tests/data");
+    fs::create_directories(root.path() / "other");
+
+    btl::FileIndex index({btl::TemplateFile::defaultConfiguration()}, root.path());
+    index.add(root.path() / "lib" / src);
+    index.add(root.path() / "lib/tests" / src);
+    index.add(root.path() / "lib/src/a.cpp");
+
+    for (const auto& entry : fs::recursive_directory_iterator(root.path())) {
+        if (entry.is_directory()) {
+            // Twice, to check the memoised answer too
+            const auto expected = btl::findUp(entry.path(), src, root.path());
+            ASSERT_EQ(index.findTemplate(entry.path(), src), expected) << entry.path();
+            ASSERT_EQ(index.findTemplate(entry.path(), src), expected) << entry.path();
+        }
+    }
+    ASSERT_FALSE(index.findTemplate(root.path(), src));
+    ASSERT_FALSE(index.findTemplate(root.path() / "lib", "unknown.mustache"));
+}
+
+TEST(FileIndexTest, findTemplateFollowsTemplateChanges)
+{
+    const btl::TempDirectory root;
+    const std::string src = btl::TemplateFile::defaultConfiguration().src;
+    const auto deep = root.path() / "lib/sub/deeper";
+
+    btl::FileIndex index({btl::TemplateFile::defaultConfiguration()}, root.path());
+    ASSERT_FALSE(index.findTemplate(deep, src));
+
+    index.add(root.path() / "lib" / src);
+    ASSERT_EQ(index.findTemplate(deep, src), root.path() / "lib" / src);
+
+    // A nearer template takes over
+    index.add(root.path() / "lib/sub" / src);
+    ASSERT_EQ(index.findTemplate(deep, src), root.path() / "lib/sub" / src);
+    ASSERT_EQ(index.findTemplate(root.path() / "lib", src), root.path() / "lib" / src);
+
+    // And hands back when it goes
+    index.remove(root.path() / "lib/sub" / src);
+    ASSERT_EQ(index.findTemplate(deep, src), root.path() / "lib" / src);
+
+    index.add(root.path() / "lib/sub" / src);
+    index.removeDirectory(root.path() / "lib/sub");
+    ASSERT_EQ(index.findTemplate(deep, src), root.path() / "lib" / src);
+
+    index.removeDirectory(root.path() / "lib");
+    ASSERT_FALSE(index.findTemplate(deep, src));
+}
@@ -21,6 +21,8 @@
  */
 
 #include "FileUtils.hpp"
+#include <TestHelpers/TempDirectory.hpp>
+#include <fstream>
 #include <gtest/gtest.h>
 
 TEST(FileUtilsTest, findAll)
@@ -33,4 +35,53 @@ TEST(FileUtilsTest, findAll)
     } else {
         FAIL() << "Could not find repo root for test, was running in " << fs::current_path() << "\n";
     }
-}
\ No newline at end of file
+}
+TEST(FileUtilsTest, writeIfChanged)
+{
+    using namespace btl;
+    namespace fs = std::filesystem;
+
+    const TempDirectory tempDirectory;
+    const auto path = tempDirectory.path() / "CMakeLists.txt";
+
+    ASSERT_TRUE(writeIfChanged(path, "one\n"));
+    const auto firstWrite = fs::last_write_time(path);
+
+    // Same content leaves the file, and its mtime, alone
+    ASSERT_FALSE(writeIfChanged(path, "one\n"));
+    ASSERT_EQ(fs::last_write_time(path), firstWrite);
+
+    ASSERT_TRUE(writeIfChanged(path, "two\n"));
+    std::ifstream is(path);
+    std::string content;
+    std::getline(is, content);
+    ASSERT_EQ(content, "two");
+
+    // No temporary files left behind
+    ASSERT_EQ(std::distance(fs::directory_iterator(tempDirectory.path()), fs::directory_iterator{}), 1);
+}
+
+TEST(FileUtilsTest, findAllPrunesSkippedDirectories)
+{
+    using namespace btl;
+    namespace fs = std::filesystem;
+
+    const TempDirectory tempDirectory;
+    fs::create_directories(tempDirectory.path() / "src");
+    fs::create_directories(tempDirectory.path() / "build/deep/er");
+    std::ofstream(tempDirectory.path() / "src/a.cpp") << "";
+    std::ofstream(tempDirectory.path() / "build/deep/er/generated.cpp") << "";
+
+    std::vector<fs::path> asked;
+    const auto skip = [&asked](const fs::path& directory) {
+        asked.push_back(directory);
+        return directory.filename() == "build";
+    };
+
+    const auto files = findAll(tempDirectory.path(), {".cpp"}, skip);
+    ASSERT_EQ(files, std::vector<fs::path>{tempDirectory.path() / "src/a.cpp"});
+
+    // Never descended into build/
+    std::ranges::sort(asked);
+    ASSERT_EQ(asked, (std::vector<fs::path>{tempDirectory.path() / "build", tempDirectory.path() / "src"}));
+}
@@ -21,9 +21,13 @@
  */
 
 #include "INotify.hpp"
+#include <TestHelpers/TempDirectory.hpp>
+#include <algorithm>
+#include <fstream>
 #include <gtest/gtest.h>
 #include <spdlog/spdlog.h>
 #include <sys/inotify.h>
+#include <thread>
 
 TEST(INotifyTest, construct)
 {
@@ -31,10 +35,225 @@ TEST(INotifyTest, construct)
     spdlog::set_level(spdlog::level::trace);
     btl::INotify inotify;
     //    inotify.addWatch(fs::path("test.txt"));
-    inotify.addWatch(fs::current_path(), [&](const inotify_event& event, const btl::INotifyWatch& watch) {
+    inotify.onEvent([&](const btl::INotifyRecord& event, const btl::INotifyWatch& watch) {
         spdlog::info("Event {}", event.mask);
         spdlog::info("Watch {}", watch.getDirectory().string());
     });
+    inotify.addWatch(fs::current_path());
 
     // const auto other = watch;
-}
\ No newline at end of file
+}
+
+TEST(INotifyTest, wakeUnblocksInfiniteWait)
+{
+    btl::INotify inotify;
+
+    std::jthread waker([&inotify] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        inotify.wake();
+    });
+
+    // Should return once woken, rather than hang forever.
+    inotify.watchOnce(btl::INotify::infinite);
+}
+
+TEST(INotifyTest, blockingWaitReceivesEvent)
+{
+    namespace fs = std::filesystem;
+    const btl::TempDirectory tempDirectory;
+    btl::INotify inotify;
+
+    std::vector<std::string> names;
+    inotify.onEvent([&names](const btl::INotifyRecord& event, const btl::INotifyWatch&) {
+        names.emplace_back(event.getName());
+    });
+    inotify.addWatch(tempDirectory.path());
+
+    std::ofstream(tempDirectory.path() / "created.cpp") << "";
+
+    inotify.watchOnce(btl::INotify::infinite);
+    ASSERT_FALSE(names.empty());
+    ASSERT_EQ(names.front(), "created.cpp");
+}
+
+TEST(INotifyTest, removeSubdirectories)
+{
+    namespace fs = std::filesystem;
+    const btl::TempDirectory tempDirectory;
+    fs::create_directories(tempDirectory.path() / "a/b");
+    fs::create_directories(tempDirectory.path() / "c");
+
+    btl::INotify inotify;
+    inotify.addWatch(tempDirectory.path());
+    inotify.addWatch(tempDirectory.path() / "a");
+    inotify.addWatch(tempDirectory.path() / "a/b");
+    inotify.addWatch(tempDirectory.path() / "c");
+
+    // Watching the same directory twice shares the kernel watch
+    ASSERT_FALSE(inotify.addWatch(tempDirectory.path() / "c"));
+    ASSERT_EQ(inotify.watchCount(), 4);
+
+    inotify.remove(tempDirectory.path() / "a");
+    ASSERT_EQ(inotify.watchCount(), 2);
+}
+
+TEST(INotifyTest, renameMovesSubtree)
+{
+    namespace fs = std::filesystem;
+    const btl::TempDirectory tempDirectory;
+    const auto& root = tempDirectory.path();
+    fs::create_directories(root / "a/b/c");
+    fs::create_directories(root / "d");
+
+    btl::INotify inotify;
+    std::vector<fs::path> directories;
+    inotify.onEvent([&directories](const btl::INotifyRecord&, const btl::INotifyWatch& watch) {
+        directories.push_back(watch.getDirectory());
+    });
+    // Children first, so they're adopted when their parents are watched
+    for (const auto* directory : {"a/b/c", "a/b", "a", "d", ""}) {
+        inotify.addWatch(root / directory);
+    }
+
+    fs::rename(root / "a", root / "d/z");
+    inotify.moveFrom(root / "a", 1234);
+    inotify.moveTo(root / "d/z", 1234);
+
+    // After the rename's own events
+    std::ofstream(root / "d/z/b/c/file.cpp") << "";
+    for (int i = 0; i < 20 && std::ranges::find(directories, root / "d/z/b/c") == directories.end(); ++i) {
+        inotify.watchOnce(std::chrono::milliseconds(50));
+    }
+    ASSERT_FALSE(directories.empty());
+    ASSERT_EQ(directories.back(), root / "d/z/b/c");
+
+    // Only the moved subtree goes
+    inotify.remove(root / "d/z/b");
+    ASSERT_EQ(inotify.watchCount(), 3);
+    inotify.remove(root / "d");
+    ASSERT_EQ(inotify.watchCount(), 1);
+}
+
+TEST(INotifyTest, unpairedMovesExpireOrNeedWatching)
+{
+    namespace fs = std::filesystem;
+    const btl::TempDirectory tempDirectory;
+    const auto& root = tempDirectory.path();
+    fs::create_directories(root / "a/b");
+
+    btl::INotify inotify;
+    for (const auto* directory : {"", "a", "a/b"}) {
+        inotify.addWatch(root / directory);
+    }
+
+    // Nothing moved away with this cookie, so it's from outside
+    ASSERT_FALSE(inotify.moveTo(root / "x", 1234));
+
+    // Never arrives anywhere, so it left the tree.  Doesn't block past the expiry.
+    inotify.moveFrom(root / "a", 5678);
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 10 && inotify.watchCount() != 1; ++i) {
+        inotify.watchOnce(btl::INotify::infinite);
+    }
+    ASSERT_EQ(inotify.watchCount(), 1);
+    ASSERT_GE(std::chrono::steady_clock::now() - start, btl::INotify::moveTimeout);
+    ASSERT_FALSE(inotify.moveTo(root / "y", 5678));
+}
+
+TEST(INotifyTest, drainsAllEventsWithSmallBuffer)
+{
+    namespace fs = std::filesystem;
+    const btl::TempDirectory tempDirectory;
+
+    // Gets rounded up to hold a single event, so we need many reads to drain the queue.
+    btl::INotify inotify(1);
+
+    std::size_t count{};
+    inotify.onEvent([&count](const btl::INotifyRecord&, const btl::INotifyWatch&) { ++count; });
+    inotify.addWatch(tempDirectory.path(), IN_CREATE);
+
+    constexpr std::size_t fileCount = 50;
+    for (std::size_t i = 0; i < fileCount; ++i) {
+        std::ofstream(tempDirectory.path() / fmt::format("file{}.cpp", i)) << "";
+    }
+
+    // The reader thread may hand them over in more than one go
+    for (int i = 0; i < 20 && count < fileCount; ++i) {
+        inotify.watchOnce(std::chrono::milliseconds(50));
+    }
+    ASSERT_EQ(count, fileCount);
+}
+
+TEST(INotifyTest, drainsMoreEventsThanTheRingHoldsInOneRead)
+{
+    namespace fs = std::filesystem;
+    const btl::TempDirectory tempDirectory;
+
+    // Big enough that one read can return more events than fit in the ring
+    btl::INotify inotify(1024 * 1024);
+
+    std::size_t count{};
+    inotify.onEvent([&count](const btl::INotifyRecord&, const btl::INotifyWatch&) { ++count; });
+    inotify.addWatch(tempDirectory.path(), IN_CREATE);
+
+    const auto fileCount = btl::INotify::ringCapacity * 3;
+    for (std::size_t i = 0; i < fileCount; ++i) {
+        std::ofstream(tempDirectory.path() / fmt::format("{:06}.cpp", i)) << "";
+    }
+
+    for (int i = 0; i < 100 && count < fileCount; ++i) {
+        inotify.watchOnce(std::chrono::milliseconds(50));
+    }
+    ASSERT_EQ(count, fileCount);
+}
+
+TEST(INotifyTest, keepsReadingWhileTheCallerIsBusy)
+{
+    namespace fs = std::filesystem;
+    std::size_t maxQueuedEvents{};
+    std::ifstream("/proc/sys/fs/inotify/max_queued_events") >> maxQueuedEvents;
+    if (maxQueuedEvents == 0 || maxQueuedEvents > 65536) {
+        GTEST_SKIP() << "Too many files needed to fill the queue: " << maxQueuedEvents;
+    }
+
+    const btl::TempDirectory tempDirectory;
+    btl::INotify inotify;
+
+    std::size_t count{};
+    bool overflowed{};
+    inotify.onEvent([&count](const btl::INotifyRecord&, const btl::INotifyWatch&) { ++count; });
+    inotify.onOverflow([&overflowed] { overflowed = true; });
+    inotify.addWatch(tempDirectory.path(), IN_CREATE);
+
+    // More than the kernel would queue, as if we were busy regenerating while they arrived
+    const auto fileCount = maxQueuedEvents + btl::INotify::ringCapacity / 2;
+    for (std::size_t i = 0; i < fileCount; ++i) {
+        std::ofstream(tempDirectory.path() / fmt::format("{:06}.cpp", i)) << "";
+    }
+
+    for (int i = 0; i < 100 && count < fileCount; ++i) {
+        inotify.watchOnce(std::chrono::milliseconds(50));
+    }
+    ASSERT_FALSE(overflowed);
+    ASSERT_EQ(count, fileCount);
+}
+
+TEST(INotifyTest, addWatchesReportsWhatItCouldNotWatch)
+{
+    namespace fs = std::filesystem;
+    const btl::TempDirectory tempDirectory;
+    for (const auto* name : {"a", "b", "c"}) {
+        fs::create_directory(tempDirectory.path() / name);
+    }
+
+    btl::INotify inotify(btl::INotify::defaultBufferSize, 2);
+    const auto& root = tempDirectory.path();
+    const auto report = inotify.addWatches({root / "a", root / "gone", root / "b", root / "c"});
+
+    ASSERT_EQ(report.requested, 4);
+    ASSERT_EQ(report.obtained, 2);
+    ASSERT_EQ(report.failed, std::vector{root / "c"});
+    ASSERT_EQ(inotify.watchCount(), 2);
+
+    ASSERT_GT(btl::INotify::maxUserWatches().value_or(1), 0);
+}
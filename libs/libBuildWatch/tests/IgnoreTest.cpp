@@ -69,3 +69,45 @@ TEST(IgnoreTest, shouldIgnoreGitFolder)
     const auto testGitDirectory = repoRoot / ".git";
     ASSERT_TRUE(gitignore.ignore(testGitDirectory));
 }
+
+TEST(IgnoreTest, globs)
+{
+    const fs::path repoRoot = "/repo";
+    const auto lines = std::vector<std::string>{
+        "build/",          // unanchored, any depth
+        "/out/",           // anchored at the root
+        "docs/*/generated/",
+        "**/cache/",
+        "tmp?/",
+        "*.o",             // not a directory pattern, skipped
+        "third-party/*/",
+        "!third-party/keep/",
+    };
+    const btl::Ignore gitignore(repoRoot, lines);
+
+    ASSERT_TRUE(gitignore.ignore(repoRoot / "build"));
+    ASSERT_TRUE(gitignore.ignore(repoRoot / "libs/foo/build"));
+    ASSERT_TRUE(gitignore.ignore(repoRoot / "libs/foo/build/CMakeFiles"));
+    ASSERT_FALSE(gitignore.ignore(repoRoot / "libs/foo/builder"));
+
+    ASSERT_TRUE(gitignore.ignore(repoRoot / "out/build"));
+    ASSERT_FALSE(gitignore.ignore(repoRoot / "libs/out"));
+
+    ASSERT_TRUE(gitignore.ignore(repoRoot / "docs/api/generated"));
+    ASSERT_FALSE(gitignore.ignore(repoRoot / "docs/api/nested/generated"));
+
+    ASSERT_TRUE(gitignore.ignore(repoRoot / "cache"));
+    ASSERT_TRUE(gitignore.ignore(repoRoot / "a/b/cache/c"));
+
+    ASSERT_TRUE(gitignore.ignore(repoRoot / "tmp1"));
+    ASSERT_FALSE(gitignore.ignore(repoRoot / "tmp"));
+
+    ASSERT_FALSE(gitignore.ignore(repoRoot / "src/thing.o"));
+
+    ASSERT_TRUE(gitignore.ignore(repoRoot / "third-party/fmt"));
+    ASSERT_FALSE(gitignore.ignore(repoRoot / "third-party/keep"));
+
+    ASSERT_FALSE(gitignore.ignore(repoRoot));
+    ASSERT_FALSE(gitignore.ignore("/elsewhere/build/x")) << "outside the repo root";
+    ASSERT_TRUE(gitignore.ignoreRelative("a/build/b"));
+}
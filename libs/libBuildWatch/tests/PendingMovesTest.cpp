@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "PendingMoves.hpp"
+#include <gtest/gtest.h>
+
+TEST(PendingMovesTest, pairsMovesByCookie)
+{
+    using namespace std::chrono_literals;
+    btl::PendingMoves<int> moves(100ms);
+    const auto start = btl::PendingMoves<int>::Clock::now();
+
+    ASSERT_TRUE(moves.empty());
+    ASSERT_FALSE(moves.timeUntilExpiry(start));
+
+    moves.add(1234, 1, start);
+    moves.add(5678, 2, start + 20ms);
+    ASSERT_EQ(moves.timeUntilExpiry(start + 10ms), 90ms);
+
+    ASSERT_EQ(moves.take(1234), 1);
+    ASSERT_FALSE(moves.take(1234));
+    ASSERT_FALSE(moves.take(9999));
+    ASSERT_EQ(moves.timeUntilExpiry(start + 10ms), 110ms);
+}
+
+TEST(PendingMovesTest, unpairedMovesExpire)
+{
+    using namespace std::chrono_literals;
+    btl::PendingMoves<int> moves(100ms);
+    const auto start = btl::PendingMoves<int>::Clock::now();
+
+    moves.add(1234, 1, start);
+    moves.add(5678, 2, start + 50ms);
+
+    ASSERT_TRUE(moves.expire(start + 99ms).empty());
+    ASSERT_EQ(moves.expire(start + 100ms), std::vector{1});
+    ASSERT_EQ(moves.timeUntilExpiry(start + 100ms), 50ms);
+    ASSERT_EQ(moves.expire(start + 200ms), std::vector{2});
+    ASSERT_TRUE(moves.empty());
+    ASSERT_FALSE(moves.take(5678));
+}
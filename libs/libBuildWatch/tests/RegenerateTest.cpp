@@ -0,0 +1,150 @@
+/*
+ * Copyright (c) 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <BuildWatch/Regenerate.hpp>
+#include <TestHelpers/TempDirectory.hpp>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+namespace {
+std::string contents(const fs::path& path)
+{
+    std::ifstream is(path);
+    std::stringstream content;
+    content << is.rdbuf();
+    return content.str();
+}
+} // namespace
+
+TEST(RegenerateTest, regeneratesEveryTemplateOnce)
+{
+    const btl::TempDirectory root;
+    for (const auto* directory : {"lib/src", "lib/nested/src", "other", ".git/lib"}) {
+        fs::create_directories(root.path() / directory);
+    }
+    for (const auto* templateDirectory : {"lib", "lib/nested", "other", ".git/lib"}) {
+        std::ofstream(root.path() / templateDirectory / "CMakeLists.txt.mustache")
+            << "{{#files}}{{relpath}}\n{{/files}}";
+    }
+    for (const auto* file : {"lib/src/a.cpp", "lib/nested/src/b.cpp", "other/c.hpp"}) {
+        std::ofstream(root.path() / file) << "";
+    }
+
+    btl::Config config{{btl::TemplateFile::defaultConfiguration()}, {}};
+
+    // Out of date, but a dry run leaves it that way
+    const auto dryRun = btl::regenerateAll(root.path(), config, true, 4);
+    ASSERT_EQ(dryRun.templates, 3);
+    ASSERT_EQ(dryRun.changed.size(), 3);
+    ASSERT_FALSE(fs::exists(root.path() / "lib/CMakeLists.txt"));
+
+    const auto report = btl::regenerateAll(root.path(), config, false, 4);
+    ASSERT_EQ(
+        report.changed,
+        (std::vector{
+            root.path() / "lib/CMakeLists.txt",
+            root.path() / "lib/nested/CMakeLists.txt",
+            root.path() / "other/CMakeLists.txt"}));
+    ASSERT_TRUE(report.failed.empty());
+    ASSERT_EQ(contents(root.path() / "lib/CMakeLists.txt"), "src/a.cpp\n");
+    ASSERT_EQ(contents(root.path() / "lib/nested/CMakeLists.txt"), "src/b.cpp\n");
+    ASSERT_FALSE(fs::exists(root.path() / ".git/lib/CMakeLists.txt"));
+
+    // Now up to date
+    ASSERT_TRUE(btl::regenerateAll(root.path(), config, false).changed.empty());
+}
+
+TEST(RegenerateTest, templatesWritingTheSameFileTakeTurns)
+{
+    const btl::TempDirectory root;
+    btl::Config config{
+        {btl::TemplateFile{"a.mustache", "out.txt", {".cpp"}}, btl::TemplateFile{"b.mustache", "out.txt", {".cpp"}}},
+        {}};
+
+    constexpr int directoryCount = 20;
+    const std::string a(64 * 1024, 'a');
+    const std::string b(32 * 1024, 'b');
+    for (int i = 0; i < directoryCount; ++i) {
+        const auto directory = root.path() / std::to_string(i);
+        fs::create_directory(directory);
+        std::ofstream(directory / "a.mustache") << a;
+        std::ofstream(directory / "b.mustache") << b;
+    }
+
+    const auto report = btl::regenerateAll(root.path(), config, false, 8);
+    ASSERT_EQ(report.templates, 2 * directoryCount);
+    ASSERT_TRUE(report.failed.empty());
+
+    // One or the other, never a mix of the two
+    for (int i = 0; i < directoryCount; ++i) {
+        const auto content = contents(root.path() / std::to_string(i) / "out.txt");
+        ASSERT_TRUE(content == a || content == b) << i;
+    }
+}
+
+TEST(RegenerateTest, reportsBrokenTemplates)
+{
+    const btl::TempDirectory root;
+    fs::create_directories(root.path() / "lib");
+    std::ofstream(root.path() / "lib/CMakeLists.txt.mustache") << "{{#files}}";
+
+    const auto report = btl::regenerateAll(root.path(), {{btl::TemplateFile::defaultConfiguration()}, {}}, false);
+    ASSERT_EQ(report.failed, std::vector{root.path() / "lib/CMakeLists.txt.mustache"});
+    ASSERT_TRUE(report.changed.empty());
+}
+
+TEST(RegenerateTest, checkReportsDifferencesWithoutWriting)
+{
+    const btl::TempDirectory root;
+    fs::create_directories(root.path() / "lib");
+    fs::create_directories(root.path() / "other");
+    for (const auto* templateDirectory : {"lib", "other"}) {
+        std::ofstream(root.path() / templateDirectory / "CMakeLists.txt.mustache")
+            << "{{#files}}{{relpath}}\n{{/files}}";
+    }
+    for (const auto* file : {"lib/a.cpp", "lib/b.cpp", "other/c.cpp"}) {
+        std::ofstream(root.path() / file) << "";
+    }
+    std::ofstream(root.path() / "lib/CMakeLists.txt") << "a.cpp\nold.cpp\n";
+    std::ofstream(root.path() / "other/CMakeLists.txt") << "c.cpp\n";
+
+    const btl::Config config{{btl::TemplateFile::defaultConfiguration()}, {}};
+    const auto report = btl::checkAll(root.path(), config);
+
+    ASSERT_EQ(report.templates, 2);
+    ASSERT_TRUE(report.failed.empty());
+    ASSERT_EQ(report.mismatches.size(), 1);
+    const auto& mismatch = report.mismatches.front();
+    ASSERT_EQ(mismatch.dest, root.path() / "lib/CMakeLists.txt");
+    ASSERT_EQ(mismatch.added, 1);
+    ASSERT_EQ(mismatch.removed, 1);
+    ASSERT_TRUE(mismatch.diff.ends_with("@@ -1,2 +1,2 @@\n a.cpp\n-old.cpp\n+b.cpp\n"));
+    ASSERT_EQ(contents(root.path() / "lib/CMakeLists.txt"), "a.cpp\nold.cpp\n");
+
+    // Long diffs are cut short
+    fs::remove(root.path() / "lib/CMakeLists.txt");
+    const auto truncated = btl::checkAll(root.path(), config, 3);
+    ASSERT_TRUE(truncated.mismatches.front().diff.ends_with("... 2 more lines\n"));
+}
@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "RenderPool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <gtest/gtest.h>
+#include <latch>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+/// Counts jobs running at once, overall and per key
+struct Concurrency
+{
+    std::mutex mutex;
+    std::map<std::string, int> running;
+    int total{};
+    int maxTotal{};
+    int maxPerKey{};
+
+    void run(const std::string& key)
+    {
+        {
+            std::scoped_lock lock(mutex);
+            maxTotal = std::max(maxTotal, ++total);
+            maxPerKey = std::max(maxPerKey, ++running[key]);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        std::scoped_lock lock(mutex);
+        --total;
+        --running[key];
+    }
+};
+} // namespace
+
+TEST(RenderPoolTest, runsDifferentKeysInParallel)
+{
+    btl::RenderPool pool(2);
+
+    // Each waits for the other, so they'd never finish one after the other
+    std::latch both(2);
+    std::atomic<int> finished{};
+    for (const auto* key : {"a", "b"}) {
+        pool.submit(key, [&] {
+            both.arrive_and_wait();
+            ++finished;
+        });
+    }
+    pool.wait();
+    ASSERT_EQ(finished, 2);
+}
+
+TEST(RenderPoolTest, runsTheSameKeyOneAtATime)
+{
+    using namespace std::chrono_literals;
+    btl::RenderPool pool(4);
+
+    std::latch started(1);
+    std::latch release(1);
+    std::vector<std::string> ran;
+    std::mutex mutex;
+    const auto record = [&](const std::string& name) {
+        std::scoped_lock lock(mutex);
+        ran.push_back(name);
+    };
+
+    pool.submit("dest", [&] {
+        started.count_down();
+        release.wait();
+        record("first");
+    });
+
+    // Once it's running it can't be replaced
+    started.wait();
+    pool.submit("dest", [&] { record("second"); });
+    pool.submit("other", [&] { record("other"); });
+
+    // There are idle workers, but the second has to wait for the first
+    const auto ranSoFar = [&] {
+        std::scoped_lock lock(mutex);
+        return ran;
+    };
+    for (int i = 0; i < 100 && ranSoFar().empty(); ++i) {
+        std::this_thread::sleep_for(1ms);
+    }
+    std::this_thread::sleep_for(10ms);
+    ASSERT_EQ(ranSoFar(), std::vector<std::string>{"other"});
+
+    release.count_down();
+    pool.wait();
+    ASSERT_EQ(ran, (std::vector<std::string>{"other", "first", "second"}));
+}
+
+TEST(RenderPoolTest, limitsJobsAtOnce)
+{
+    Concurrency concurrency;
+    {
+        btl::RenderPool pool(3);
+        ASSERT_EQ(pool.maxThreads(), 3);
+        for (int i = 0; i < 30; ++i) {
+            pool.submit(std::to_string(i), [&concurrency, i] { concurrency.run(std::to_string(i)); });
+        }
+    }
+
+    // Destruction finishes the queue
+    ASSERT_EQ(concurrency.total, 0);
+    ASSERT_LE(concurrency.maxTotal, 3);
+    ASSERT_EQ(concurrency.maxPerKey, 1);
+}
+
+TEST(RenderPoolTest, replacesQueuedJobsWithTheSameKey)
+{
+    btl::RenderPool pool(1);
+
+    // Keep the only worker busy, so the rest queue up behind it
+    std::latch release(1);
+    pool.submit("busy", [&release] { release.wait(); });
+
+    std::vector<int> ran;
+    for (int i = 0; i < 3; ++i) {
+        pool.submit("dest", [&ran, i] { ran.push_back(i); });
+    }
+    release.count_down();
+    pool.wait();
+
+    ASSERT_EQ(ran, std::vector<int>{2});
+}
+
+TEST(RenderPoolTest, zeroMeansOnePerCore)
+{
+    const btl::RenderPool pool(0);
+    ASSERT_GE(pool.maxThreads(), 1);
+}
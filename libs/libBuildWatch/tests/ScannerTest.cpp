@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "Scanner.hpp"
+#include <TestHelpers/TempDirectory.hpp>
+#include <fstream>
+#include <gmock/gmock-matchers.h>
+#include <gtest/gtest.h>
+
+namespace fs = std::filesystem;
+
+TEST(ScannerTest, scansAndPrunes)
+{
+    const btl::TempDirectory root;
+    for (const auto* directory : {"a/b/c", "a/d", "build/x/y", "e"}) {
+        fs::create_directories(root.path() / directory);
+    }
+    for (const auto* file : {"a/one.cpp", "a/b/c/two.cpp", "build/x/y/generated.cpp", "e/three.hpp"}) {
+        std::ofstream(root.path() / file) << "";
+    }
+    fs::create_directory_symlink(root.path() / "a", root.path() / "e/link-to-a");
+    fs::create_symlink(root.path() / "a/one.cpp", root.path() / "e/link-to-one.cpp");
+
+    std::atomic<int> skipCalls{};
+    const auto skip = [&](const fs::path& directory) {
+        ++skipCalls;
+        return directory.filename() == "build";
+    };
+
+    for (const std::size_t threads : {1, 4}) {
+        skipCalls = 0;
+        const auto [directories, files, modified] = btl::scanTree(root.path(), skip, threads);
+
+        ASSERT_THAT(
+            directories,
+            testing::ElementsAre(
+                root.path(), root.path() / "a", root.path() / "a/b", root.path() / "a/b/c", root.path() / "a/d",
+                root.path() / "e"));
+        ASSERT_THAT(
+            files,
+            testing::ElementsAre(
+                root.path() / "a/b/c/two.cpp", root.path() / "a/one.cpp", root.path() / "e/link-to-one.cpp",
+                root.path() / "e/three.hpp"));
+
+        // Nothing beneath build/ is even looked at
+        ASSERT_EQ(skipCalls, 6);
+
+        ASSERT_EQ(modified.size(), directories.size());
+        ASSERT_EQ(modified.front(), fs::last_write_time(root.path()));
+        ASSERT_TRUE(std::ranges::none_of(modified, [](const auto time) { return time == fs::file_time_type::min(); }));
+    }
+}
+
+TEST(ScannerTest, scansSeveralRootsAtOnce)
+{
+    const btl::TempDirectory root;
+    for (const auto* directory : {"a/b", "c/d", "e"}) {
+        fs::create_directories(root.path() / directory);
+    }
+    for (const auto* file : {"a/one.cpp", "a/b/two.cpp", "c/d/three.cpp", "e/four.cpp"}) {
+        std::ofstream(root.path() / file) << "";
+    }
+
+    // c/d is a root in its own right, so c's walk leaves it alone
+    const auto skip = [&](const fs::path& directory) { return directory == root.path() / "c/d"; };
+
+    for (const std::size_t threads : {1, 4}) {
+        const auto [directories, files, modified] = btl::scanTree(
+            std::vector{root.path() / "a", root.path() / "c", root.path() / "c/d"}, skip, threads);
+
+        ASSERT_THAT(
+            directories,
+            testing::ElementsAre(root.path() / "a", root.path() / "a/b", root.path() / "c", root.path() / "c/d"));
+        ASSERT_THAT(
+            files,
+            testing::ElementsAre(
+                root.path() / "a/b/two.cpp", root.path() / "a/one.cpp", root.path() / "c/d/three.cpp"));
+        ASSERT_EQ(modified.size(), directories.size());
+    }
+
+    ASSERT_TRUE(btl::scanTree(std::vector<fs::path>{}, skip).directories.empty());
+}
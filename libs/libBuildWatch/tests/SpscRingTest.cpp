@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "SpscRing.hpp"
+#include <gtest/gtest.h>
+#include <thread>
+
+TEST(SpscRingTest, boundedFirstInFirstOut)
+{
+    btl::SpscRing<int> ring(3);
+    ASSERT_EQ(ring.capacity(), 4);
+
+    for (int i = 0; i < 4; ++i) {
+        ASSERT_TRUE(ring.tryPush(i));
+    }
+    ASSERT_FALSE(ring.tryPush(4));
+
+    int value{};
+    ASSERT_TRUE(ring.tryPop(value));
+    ASSERT_EQ(value, 0);
+    ASSERT_TRUE(ring.tryPush(4));
+
+    for (int expected = 1; expected <= 4; ++expected) {
+        ASSERT_TRUE(ring.tryPop(value));
+        ASSERT_EQ(value, expected);
+    }
+    ASSERT_FALSE(ring.tryPop(value));
+}
+
+TEST(SpscRingTest, producerWaitsForRoom)
+{
+    btl::SpscRing<int> ring(16);
+    const std::atomic<bool> stop{};
+    constexpr int count = 100'000;
+
+    std::jthread producer([&ring, &stop] {
+        for (int i = 0; i < count; ++i) {
+            ring.push(i, stop);
+        }
+    });
+
+    // Far more than fits, so the producer has to keep waiting for us
+    int value{};
+    for (int expected = 0; expected < count; ++expected) {
+        while (!ring.tryPop(value)) {
+            std::this_thread::yield();
+        }
+        ASSERT_EQ(value, expected);
+    }
+}
+
+TEST(SpscRingTest, stopsWaitingProducer)
+{
+    btl::SpscRing<int> ring(2);
+    std::atomic<bool> stop{};
+    std::atomic<bool> pushed{true};
+
+    ASSERT_TRUE(ring.tryPush(0));
+    ASSERT_TRUE(ring.tryPush(1));
+    std::jthread producer([&] {
+        while (ring.push(2, stop)) {
+        }
+        pushed = false;
+    });
+
+    stop = true;
+    int value{};
+    while (pushed) {
+        (void) ring.tryPop(value);
+        std::this_thread::yield();
+    }
+}
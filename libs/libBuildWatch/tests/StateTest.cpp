@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "State.hpp"
+#include <TestHelpers/TempDirectory.hpp>
+#include <fstream>
+#include <gtest/gtest.h>
+
+namespace fs = std::filesystem;
+
+TEST(StateTest, roundTrips)
+{
+    const btl::TempDirectory root;
+    const auto path = root.path() / ".config/BuildWatch/state.json";
+
+    btl::State state{.fingerprint = btl::digest("config")};
+    state.directories.emplace(
+        root.path().string(), btl::State::Directory{fs::last_write_time(root.path()), {"a.cpp", "b.hpp"}});
+    state.outputs.emplace(
+        (root.path() / "CMakeLists.txt.mustache").string(),
+        btl::State::Output{btl::digest(std::vector<fs::path>{"a.cpp"}), fs::file_time_type::min(), {}});
+    btl::writeState(path, state);
+
+    const auto read = btl::readState(path, state.fingerprint);
+    ASSERT_TRUE(read.has_value());
+    ASSERT_EQ(read->directories.size(), 1);
+    ASSERT_EQ(read->directories.begin()->second.modified, state.directories.begin()->second.modified);
+    ASSERT_EQ(read->directories.begin()->second.files, state.directories.begin()->second.files);
+    ASSERT_EQ(read->outputs, state.outputs);
+}
+
+TEST(StateTest, ignoresMismatchedOrBrokenState)
+{
+    const btl::TempDirectory root;
+    const auto path = root.path() / "state.json";
+
+    ASSERT_FALSE(btl::readState(path, "fingerprint").has_value());
+
+    btl::writeState(path, btl::State{.fingerprint = "old"});
+    ASSERT_TRUE(btl::readState(path, "old").has_value());
+    ASSERT_FALSE(btl::readState(path, "new").has_value());
+
+    std::ofstream(path) << "{\"version\": 1, \"fingerprint\": \"old\"";
+    ASSERT_FALSE(btl::readState(path, "old").has_value());
+}
+
+TEST(StateTest, digestsDifferentListsDifferently)
+{
+    using Paths = std::vector<fs::path>;
+    ASSERT_EQ(btl::digest(Paths{"a", "b"}), btl::digest(Paths{"a", "b"}));
+    ASSERT_NE(btl::digest(Paths{"a", "b"}), btl::digest(Paths{"ab"}));
+    ASSERT_NE(btl::digest(Paths{"a", "b"}), btl::digest(Paths{"b", "a"}));
+}
@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "FilesTemplate.hpp"
+#include "Template.hpp"
+#include "TemplateCache.hpp"
+#include <TestHelpers/TempDirectory.hpp>
+#include <fstream>
+#include <gtest/gtest.h>
+
+TEST(TemplateTest, render)
+{
+    btl::Template tmpl("files:{{#files}} {{relpath}}{{^last}},{{/last}}{{/files}}\n");
+    ASSERT_EQ(tmpl.render({"a.cpp", "sub/b.hpp"}), "files: a.cpp, sub/b.hpp\n");
+    ASSERT_EQ(tmpl.render({}), "files:\n");
+
+    ASSERT_THROW(btl::Template("{{#files}}"), std::invalid_argument);
+}
+
+// Expected output is what kainjow mustache gives
+TEST(TemplateTest, filesTemplateMatchesMustache)
+{
+    const auto render = [](const std::string& content, const std::vector<std::filesystem::path>& files) {
+        const auto tmpl = btl::FilesTemplate::compile(content);
+        EXPECT_TRUE(tmpl) << content;
+        std::string output;
+        tmpl->render(files, output);
+        return output;
+    };
+
+    // Standalone section tags take their lines with them
+    ASSERT_EQ(
+        render("add_library(lib\n{{#files}}\n    {{relpath}}\n{{/files}}\n)\n", {"a.cpp", "sub/b.hpp"}),
+        "add_library(lib\n    a.cpp\n    sub/b.hpp\n)\n");
+    ASSERT_EQ(
+        render("x\r\n  {{#files}}  \r\n {{ relpath }}\r\n  {{/files}}\r\nend", {"a.cpp", "b.h"}),
+        "x\r\n a.cpp\r\n b.h\r\nend");
+
+    // HTML escaped, unless asked not to be
+    ASSERT_EQ(
+        render("{{#files}}{{relpath}}|{{{relpath}}}|{{& relpath}}{{^last}},{{/last}}{{/files}}", {"a&'b'.cpp", "c.h"}),
+        "a&amp;&apos;b&apos;.cpp|a&'b'.cpp|a&'b'.cpp,c.h|c.h|c.h");
+
+    ASSERT_EQ(render("{{! files }}[{{#files}}{{relpath}}{{#last}}.{{/last}}{{/files}}]", {}), "[]");
+}
+
+TEST(TemplateTest, fallsBackForOtherMustache)
+{
+    ASSERT_FALSE(btl::FilesTemplate::compile("{{#files}}{{name}}{{/files}}"));
+    ASSERT_FALSE(btl::FilesTemplate::compile("{{relpath}}"));
+    ASSERT_FALSE(btl::FilesTemplate::compile("{{> partial}}"));
+    ASSERT_FALSE(btl::FilesTemplate::compile("{{#files}}"));
+
+    const auto content = "{{=<% %>=}}<%#files%><%relpath%> <%/files%>";
+    ASSERT_FALSE(btl::FilesTemplate::compile(content));
+    ASSERT_EQ(btl::Template(content).render({"a.cpp", "b.h"}), "a.cpp b.h ");
+}
+
+TEST(TemplateTest, cacheReadsOnceUntilInvalidated)
+{
+    const btl::TempDirectory root;
+    const auto path = root.path() / "CMakeLists.txt.mustache";
+    std::ofstream(path) << "{{#files}}{{relpath}}{{/files}}";
+
+    btl::TemplateCache cache;
+    ASSERT_EQ(cache.get(path)->render({"a.cpp"}), "a.cpp");
+
+    // Not re-read until we're told it changed
+    std::ofstream(path) << "[{{#files}}{{relpath}}{{/files}}]";
+    ASSERT_EQ(cache.get(path)->render({"a.cpp"}), "a.cpp");
+    cache.invalidate(path);
+    ASSERT_EQ(cache.get(path)->render({"a.cpp"}), "[a.cpp]");
+
+    cache.invalidateDirectory(root.path());
+    ASSERT_EQ(cache.size(), 0);
+
+    ASSERT_THROW((void)cache.get(root.path() / "missing.mustache"), std::runtime_error);
+}
+
+TEST(TemplateTest, cacheInvalidatesModifiedTemplates)
+{
+    namespace fs = std::filesystem;
+    const btl::TempDirectory root;
+    const auto edited = root.path() / "a.mustache";
+    const auto untouched = root.path() / "b.mustache";
+    std::ofstream(edited) << "{{#files}}{{relpath}}{{/files}}";
+    std::ofstream(untouched) << "{{#files}}{{relpath}}{{/files}}";
+
+    btl::TemplateCache cache;
+    (void) cache.get(edited);
+    (void) cache.get(untouched);
+
+    // Without telling the cache, as if we missed the event
+    std::ofstream(edited) << "[{{#files}}{{relpath}}{{/files}}]";
+    fs::last_write_time(edited, fs::last_write_time(edited) + std::chrono::seconds(1));
+
+    ASSERT_EQ(cache.invalidateModified(), std::vector{edited});
+    ASSERT_EQ(cache.size(), 1);
+    ASSERT_EQ(cache.get(edited)->render({"a.cpp"}), "[a.cpp]");
+}
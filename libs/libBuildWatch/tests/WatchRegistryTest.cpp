@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2024.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "WatchRegistry.hpp"
+#include <gtest/gtest.h>
+
+TEST(WatchRegistryTest, buildsPathsFromTheTree)
+{
+    btl::WatchRegistry registry;
+    // Children before their parents, as well as after
+    const auto c = registry.add(4, "/root/a/b/c", 0);
+    const auto a = registry.add(2, "/root/a", 0);
+    const auto root = registry.add(1, "/root", 0);
+    const auto b = registry.add(3, "/root/a/b", 0);
+
+    ASSERT_EQ(registry.size(), 4);
+    ASSERT_EQ(registry.directory(c), "/root/a/b/c");
+    ASSERT_EQ(registry.parent(c), b);
+    ASSERT_EQ(registry.parent(b), a);
+    ASSERT_EQ(registry.parent(a), root);
+    ASSERT_EQ(registry.parent(root), btl::WatchRegistry::none);
+
+    ASSERT_EQ(registry.find(3), b);
+    ASSERT_EQ(registry.find(9), btl::WatchRegistry::none);
+    ASSERT_EQ(registry.find("/root/a/b"), b);
+    ASSERT_EQ(registry.find("/root/a/x"), btl::WatchRegistry::none);
+    ASSERT_EQ(registry.find("/elsewhere"), btl::WatchRegistry::none);
+}
+
+TEST(WatchRegistryTest, moveAndRemoveSubtrees)
+{
+    btl::WatchRegistry registry;
+    registry.add(1, "/root", 0);
+    const auto a = registry.add(2, "/root/a", 0);
+    registry.add(3, "/root/a/b", 0);
+    registry.add(4, "/root/a/b/c", 0);
+    const auto d = registry.add(5, "/root/d", 0);
+
+    registry.move(a, "/root/d/z");
+    ASSERT_EQ(registry.directory(registry.find(4)), "/root/d/z/b/c");
+    ASSERT_EQ(registry.find("/root/a"), btl::WatchRegistry::none);
+    ASSERT_EQ(registry.parent(a), d);
+
+    ASSERT_EQ(registry.removeSubtree(registry.find("/root/d/z/b")), (std::vector{3, 4}));
+    ASSERT_EQ(registry.size(), 3);
+    ASSERT_EQ(registry.find(4), btl::WatchRegistry::none);
+
+    // Freed indexes are reused
+    const auto e = registry.add(6, "/root/d/z/e", 0);
+    ASSERT_LT(e, 5);
+    ASSERT_EQ(registry.directory(e), "/root/d/z/e");
+
+    ASSERT_EQ(registry.removeSubtree(d).size(), 3);
+    ASSERT_EQ(registry.size(), 1);
+}
+
+TEST(WatchRegistryTest, replacesStaleWatches)
+{
+    btl::WatchRegistry registry;
+    registry.add(1, "/root", 0);
+    registry.add(2, "/root/a", 0);
+    registry.add(3, "/root/a/b", 0);
+
+    // Deleted and recreated before we heard, so it's a new wd
+    const auto a = registry.add(4, "/root/a", 0);
+    ASSERT_EQ(registry.find("/root/a"), a);
+    ASSERT_EQ(registry.find(2), btl::WatchRegistry::none);
+    ASSERT_EQ(registry.find(3), btl::WatchRegistry::none);
+    ASSERT_EQ(registry.size(), 2);
+}